@@ -0,0 +1,216 @@
+#include "AabbTree.h"
+
+#include <algorithm>
+
+
+AabbTree::AabbTree(size_t capacity) {
+	nodes.reserve(capacity ? 2 * capacity - 1 : 0);
+	stack.reserve(64);
+}
+
+
+int32_t AabbTree::insert(const Aabb& box, uint32_t data) {
+	int32_t leaf = allocate();
+	nodes[leaf].box = box;
+	nodes[leaf].data = data;
+	insertLeaf(leaf);
+	proxyCount++;
+	return leaf;
+}
+
+
+void AabbTree::remove(int32_t proxy) {
+	removeLeaf(proxy);
+	release(proxy);
+	proxyCount--;
+}
+
+
+bool AabbTree::move(int32_t proxy, const Aabb& tight, const Aabb& box) {
+	if (nodes[proxy].box.contains(tight)) {
+		return false;
+	}
+	removeLeaf(proxy);
+	nodes[proxy].box = box;
+	insertLeaf(proxy);
+	return true;
+}
+
+
+void AabbTree::clear() {
+	nodes.clear();
+	root = none;
+	freeList = none;
+	proxyCount = 0;
+}
+
+
+int32_t AabbTree::allocate() {
+	int32_t node;
+	if (freeList != none) {
+		node = freeList;
+		freeList = nodes[node].parent;
+	}
+	else {
+		node = static_cast<int32_t>(nodes.size());
+		nodes.emplace_back();
+	}
+	nodes[node].parent = none;
+	nodes[node].child1 = none;
+	nodes[node].child2 = none;
+	nodes[node].height = 0;
+	nodes[node].data = 0;
+	return node;
+}
+
+
+void AabbTree::release(int32_t node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+
+void AabbTree::insertLeaf(int32_t leaf) {
+	if (root == none) {
+		root = leaf;
+		nodes[leaf].parent = none;
+		return;
+	}
+
+	// Walk down to the best sibling: at each node, going into a child costs
+	// what that child's box grows by, on top of what every box above it has
+	// to grow; stopping costs a new parent around this node and the leaf
+	const Aabb box = nodes[leaf].box;
+	int32_t index = root;
+	while (!nodes[index].isLeaf()) {
+		const Node& node = nodes[index];
+		float area = node.box.perimeter();
+		float combined = node.box.merged(box).perimeter();
+		float cost = 2.f * combined;
+		float inherited = 2.f * (combined - area);
+
+		auto descendCost = [&](int32_t child) {
+			const Aabb& childBox = nodes[child].box;
+			float grown = childBox.merged(box).perimeter();
+			return nodes[child].isLeaf() ? grown + inherited : grown - childBox.perimeter() + inherited;
+		};
+		float cost1 = descendCost(node.child1);
+		float cost2 = descendCost(node.child2);
+		if (cost < cost1 && cost < cost2) break;
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	// A new parent takes the sibling's place, with the sibling and the leaf
+	// under it
+	int32_t sibling = index;
+	int32_t oldParent = nodes[sibling].parent;
+	int32_t parent = allocate();
+	nodes[parent].parent = oldParent;
+	nodes[parent].box = box.merged(nodes[sibling].box);
+	nodes[parent].height = nodes[sibling].height + 1;
+	nodes[parent].child1 = sibling;
+	nodes[parent].child2 = leaf;
+	nodes[sibling].parent = parent;
+	nodes[leaf].parent = parent;
+	if (oldParent == none) {
+		root = parent;
+	}
+	else if (nodes[oldParent].child1 == sibling) {
+		nodes[oldParent].child1 = parent;
+	}
+	else {
+		nodes[oldParent].child2 = parent;
+	}
+
+	refitFrom(oldParent);
+}
+
+
+void AabbTree::removeLeaf(int32_t leaf) {
+	if (leaf == root) {
+		root = none;
+		return;
+	}
+
+	// The leaf's parent goes, and the sibling takes its place
+	int32_t parent = nodes[leaf].parent;
+	int32_t grandParent = nodes[parent].parent;
+	int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+	nodes[sibling].parent = grandParent;
+	release(parent);
+	if (grandParent == none) {
+		root = sibling;
+		return;
+	}
+	if (nodes[grandParent].child1 == parent) {
+		nodes[grandParent].child1 = sibling;
+	}
+	else {
+		nodes[grandParent].child2 = sibling;
+	}
+	refitFrom(grandParent);
+}
+
+
+void AabbTree::refitFrom(int32_t node) {
+	while (node != none) {
+		node = balance(node);
+		Node& n = nodes[node];
+		n.height = 1 + std::max(nodes[n.child1].height, nodes[n.child2].height);
+		n.box = nodes[n.child1].box.merged(nodes[n.child2].box);
+		node = n.parent;
+	}
+}
+
+
+int32_t AabbTree::balance(int32_t a) {
+	if (nodes[a].isLeaf() || nodes[a].height < 2) {
+		return a;
+	}
+
+	int32_t b = nodes[a].child1;
+	int32_t c = nodes[a].child2;
+	int32_t difference = nodes[c].height - nodes[b].height;
+	if (difference >= -1 && difference <= 1) {
+		return a;
+	}
+
+	// The taller child `up` moves into a's place, a becomes its child, and
+	// a keeps the shorter of up's children in place of `up`
+	bool rightHeavy = difference > 1;
+	int32_t up = rightHeavy ? c : b;
+	int32_t kept = rightHeavy ? b : c;
+	int32_t f = nodes[up].child1;
+	int32_t g = nodes[up].child2;
+
+	nodes[up].child1 = a;
+	nodes[up].parent = nodes[a].parent;
+	nodes[a].parent = up;
+	if (nodes[up].parent == none) {
+		root = up;
+	}
+	else if (nodes[nodes[up].parent].child1 == a) {
+		nodes[nodes[up].parent].child1 = up;
+	}
+	else {
+		nodes[nodes[up].parent].child2 = up;
+	}
+
+	int32_t taller = nodes[f].height > nodes[g].height ? f : g;
+	int32_t shorter = taller == f ? g : f;
+	nodes[up].child2 = taller;
+	if (rightHeavy) {
+		nodes[a].child2 = shorter;
+	}
+	else {
+		nodes[a].child1 = shorter;
+	}
+	nodes[shorter].parent = a;
+
+	nodes[a].box = nodes[kept].box.merged(nodes[shorter].box);
+	nodes[a].height = 1 + std::max(nodes[kept].height, nodes[shorter].height);
+	nodes[up].box = nodes[a].box.merged(nodes[taller].box);
+	nodes[up].height = 1 + std::max(nodes[a].height, nodes[taller].height);
+	return up;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A dynamic bounding volume hierarchy over axis-aligned boxes, for finding the
+// few objects near a point or path among many of any size.
+//
+// Each proxy's box is a leaf; every inner node's box encloses its two
+// children's. Inserting picks the sibling that grows the tree's boxes least,
+// then refits the boxes on the way back up, rotating nodes wherever one side
+// has grown two levels taller than the other, so queries stay logarithmic
+// whatever order objects arrive in and however much their sizes differ.
+//
+// The boxes are meant to be fat: a proxy's box should cover wherever the
+// object can get to while it's in the tree (plus some slack for rounding), so
+// it can move without the tree changing. A box the object has outgrown is
+// replaced with move().
+//
+// Nodes live in one array and are recycled through a free list; once the
+// array has grown to 2 * capacity - 1 nodes nothing allocates.
+//
+// Example:
+//   AabbTree tree(entityCount);
+//   int32_t proxy = tree.insert(Aabb::around(position, radius + margin), i);
+//   tree.query(Aabb::around(shipPosition, shipRadius), [&](uint32_t i) { ... });
+//   tree.remove(proxy);
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+struct Aabb {
+	glm::vec2 min;
+	glm::vec2 max;
+
+	static Aabb around(glm::vec2 center, float radius) {
+		return Aabb{ center - glm::vec2(radius), center + glm::vec2(radius) };
+	}
+
+	bool overlaps(const Aabb& other) const {
+		return min.x <= other.max.x && other.min.x <= max.x
+			&& min.y <= other.max.y && other.min.y <= max.y;
+	}
+
+	bool contains(const Aabb& other) const {
+		return min.x <= other.min.x && min.y <= other.min.y
+			&& other.max.x <= max.x && other.max.y <= max.y;
+	}
+
+	Aabb merged(const Aabb& other) const {
+		return Aabb{ glm::min(min, other.min), glm::max(max, other.max) };
+	}
+
+	// The insertion cost: what a query pays to visit the box grows with it
+	float perimeter() const {
+		return 2.f * ((max.x - min.x) + (max.y - min.y));
+	}
+};
+
+
+class AabbTree {
+
+public:
+	static constexpr int32_t none = -1;
+
+	// Reserves nodes for `capacity` proxies at once
+	explicit AabbTree(size_t capacity = 0);
+
+	// Public interface
+	// Adds a proxy with the given box; `data` is what queries report for it
+	int32_t insert(const Aabb& box, uint32_t data);
+	void remove(int32_t proxy);
+	// Gives the proxy `box` unless its box already contains `tight`. True if
+	// the tree changed.
+	bool move(int32_t proxy, const Aabb& tight, const Aabb& box);
+	void clear();
+
+	const Aabb& box(int32_t proxy) const { return nodes[proxy].box; }
+	size_t size() const { return proxyCount; }
+	// 0 for a single proxy; about log2(size()) when balanced
+	int height() const { return root == none ? 0 : nodes[root].height; }
+
+	// Calls fn(data) for every proxy whose box overlaps `box`, in no
+	// particular order. Not reentrant: one query at a time.
+	template <typename Fn>
+	void query(const Aabb& box, Fn fn) const {
+		if (root == none) return;
+		stack.clear();
+		stack.push_back(root);
+		while (!stack.empty()) {
+			const Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (!node.box.overlaps(box)) continue;
+			if (node.isLeaf()) {
+				fn(node.data);
+			}
+			else {
+				stack.push_back(node.child1);
+				stack.push_back(node.child2);
+			}
+		}
+	}
+
+private:
+	struct Node {
+		Aabb box;
+		int32_t parent;		// the next free node while on the free list
+		int32_t child1;
+		int32_t child2;
+		int32_t height;		// 0 for a leaf
+		uint32_t data;
+
+		bool isLeaf() const { return child1 == none; }
+	};
+
+	std::vector<Node> nodes;
+	int32_t root = none;
+	int32_t freeList = none;
+	size_t proxyCount = 0;
+	// Nodes still to visit in query(), kept so queries don't allocate
+	mutable std::vector<int32_t> stack;
+
+	int32_t allocate();
+	void release(int32_t node);
+	void insertLeaf(int32_t leaf);
+	void removeLeaf(int32_t leaf);
+	// Refits boxes and heights from `node` up to the root, rotating as it goes
+	void refitFrom(int32_t node);
+	// Rotates the taller grandchild up if the node is out of balance; returns
+	// the node now in its place
+	int32_t balance(int32_t node);
+};
@@ -0,0 +1,194 @@
+#include "AllocTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <malloc.h>
+#else
+#include <csignal>
+#endif
+
+
+namespace {
+	std::atomic<uint64_t> totalAllocations{ 0 };
+	std::atomic<uint64_t> totalBytes{ 0 };
+	std::atomic<uint64_t> totalFrees{ 0 };
+	std::atomic<bool> breakOnViolation{ false };
+
+	// Plain data only: these are read and written inside operator new, which
+	// may run before main() and must never allocate itself
+	thread_local AllocTracker::Counts tlsCounts;
+	thread_local bool tlsForbidden = false;
+	thread_local uint64_t tlsViolations = 0;
+
+	void violation() {
+		tlsViolations++;
+		if (breakOnViolation.load(std::memory_order_relaxed)) {
+			tlsForbidden = false; // let the debugger (and whatever it calls) allocate
+#if defined(_MSC_VER)
+			__debugbreak();
+#else
+			std::raise(SIGTRAP);
+#endif
+		}
+	}
+
+	void countAllocation(std::size_t size) {
+		tlsCounts.allocations++;
+		tlsCounts.bytes += size;
+		totalAllocations.fetch_add(1, std::memory_order_relaxed);
+		totalBytes.fetch_add(size, std::memory_order_relaxed);
+		if (tlsForbidden) {
+			violation();
+		}
+	}
+
+	void countFree(void* pointer) {
+		if (!pointer) return;
+		tlsCounts.frees++;
+		totalFrees.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void* allocate(std::size_t size) {
+		countAllocation(size);
+		return std::malloc(size ? size : 1);
+	}
+
+	void* allocateAligned(std::size_t size, std::size_t alignment) {
+		countAllocation(size);
+		if (size == 0) size = 1;
+#if defined(_MSC_VER)
+		return _aligned_malloc(size, alignment);
+#else
+		void* pointer = nullptr;
+		return posix_memalign(&pointer, alignment, size) == 0 ? pointer : nullptr;
+#endif
+	}
+
+	void freeAligned(void* pointer) {
+		countFree(pointer);
+#if defined(_MSC_VER)
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+}
+
+
+namespace AllocTracker {
+	Counts total() {
+		return {
+			totalAllocations.load(std::memory_order_relaxed),
+			totalBytes.load(std::memory_order_relaxed),
+			totalFrees.load(std::memory_order_relaxed),
+		};
+	}
+
+	Counts thread() {
+		return tlsCounts;
+	}
+
+	void forbid(bool forbidden) {
+		tlsForbidden = forbidden;
+	}
+
+	uint64_t violations() {
+		return tlsViolations;
+	}
+
+	void setBreakOnViolation(bool enabled) {
+		breakOnViolation = enabled;
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// The replacements. Every other form of new and delete forwards to these.
+//------------------------------------------------------------------------------
+
+void* operator new(std::size_t size) {
+	if (void* pointer = allocate(size)) return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	if (void* pointer = allocateAligned(size, static_cast<std::size_t>(alignment))) return pointer;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return allocateAligned(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+	countFree(pointer);
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+	operator delete(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+	operator delete(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	operator delete(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+	freeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+	freeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+	freeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+	freeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+	freeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+	freeAligned(pointer);
+}
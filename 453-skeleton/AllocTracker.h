@@ -0,0 +1,41 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Counts heap allocations by replacing the global operator new and delete.
+//
+// total() covers every thread since startup and thread() just the calling
+// one; the difference between two snapshots is what happened in between, so
+// the render loop reports allocations per frame and the tracer per zone.
+//
+// The goal is a render loop that doesn't allocate once it has warmed up. To
+// help get there, forbid() makes every allocation on the calling thread a
+// violation; with setBreakOnViolation(true) the first one stops in the
+// debugger (or aborts without one), right at the offending call.
+//
+// Only C++ allocations are seen; malloc() calls (e.g. inside the GL driver)
+// aren't.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+
+
+namespace AllocTracker {
+	struct Counts {
+		uint64_t allocations = 0;
+		uint64_t bytes = 0;
+		uint64_t frees = 0;
+	};
+
+	inline Counts operator-(const Counts& a, const Counts& b) {
+		return { a.allocations - b.allocations, a.bytes - b.bytes, a.frees - b.frees };
+	}
+
+	Counts total();
+	Counts thread();
+
+	// While forbidden, allocations on this thread count as violations
+	void forbid(bool forbidden);
+	uint64_t violations();		// this thread's, since startup
+
+	void setBreakOnViolation(bool enabled);
+}
@@ -0,0 +1,322 @@
+#include "AlphaMask.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace {
+	using Pose = AlphaMask::Pose;
+	using Level = AlphaMask::Level;
+
+	// Q16.16 times Q16.16: Q32.32
+	int64_t Cross(int64_t ax, int64_t ay, int64_t bx, int64_t by) {
+		return ax * by - ay * bx;
+	}
+
+	// numerator / denominator in Q16.16, for two values in the same units
+	int64_t Ratio(int64_t numerator, int64_t denominator) {
+		return numerator * Fixed::one / denominator;
+	}
+
+	// An affine map from one mask level's texel coordinates to another's,
+	// in Q16.16: to = origin + x * perX + y * perY
+	struct TexelMap {
+		int64_t originU, originV;
+		int64_t uPerX, vPerX;
+		int64_t uPerY, vPerY;
+
+		// Where the centre of texel (x, y) lands
+		int64_t u(int x, int y) const { return originU + (((2 * x + 1) * uPerX + (2 * y + 1) * uPerY) >> 1); }
+		int64_t v(int x, int y) const { return originV + (((2 * x + 1) * vPerX + (2 * y + 1) * vPerY) >> 1); }
+	};
+
+	// A texel coordinate u in `to` is (local x + 1) / 2 * width, and local
+	// x is the world offset from its centre crossed with its y axis, over
+	// the determinant. False if `to` has no area.
+	bool MapTexels(const Pose& from, const Level& fromLevel, const Pose& to, const Level& toLevel, TexelMap& map) {
+		const int64_t det = Cross(to.axisXx, to.axisXy, to.axisYx, to.axisYy);
+		if (det == 0) return false;
+
+		const int64_t fromW = fromLevel.width;
+		const int64_t fromH = fromLevel.height;
+		const int64_t toW = toLevel.width;
+		const int64_t toH = toLevel.height;
+		// The corner of `from` that texel (0, 0) starts at, relative to `to`
+		const int64_t cornerX = int64_t(from.x) - from.axisXx - from.axisYx - to.x;
+		const int64_t cornerY = int64_t(from.y) - from.axisXy - from.axisYy - to.y;
+
+		map.originU = Ratio(toW * Cross(cornerX, cornerY, to.axisYx, to.axisYy), 2 * det) + toW * Fixed::one / 2;
+		map.originV = Ratio(toH * Cross(to.axisXx, to.axisXy, cornerX, cornerY), 2 * det) + toH * Fixed::one / 2;
+		// One texel of `from` is 2 / width of its axis
+		map.uPerX = Ratio(toW * Cross(from.axisXx, from.axisXy, to.axisYx, to.axisYy), fromW * det);
+		map.vPerX = Ratio(toH * Cross(to.axisXx, to.axisXy, from.axisXx, from.axisXy), fromW * det);
+		map.uPerY = Ratio(toW * Cross(from.axisYx, from.axisYy, to.axisYx, to.axisYy), fromH * det);
+		map.vPerY = Ratio(toH * Cross(to.axisXx, to.axisXy, from.axisYx, from.axisYy), fromH * det);
+		return true;
+	}
+
+	// Of a nonzero word
+	int LowestBit(uint64_t word) {
+#if defined(_MSC_VER)
+		unsigned long bit;
+		_BitScanForward64(&bit, word);
+		return static_cast<int>(bit);
+#else
+		return __builtin_ctzll(word);
+#endif
+	}
+
+	int HighestBit(uint64_t word) {
+#if defined(_MSC_VER)
+		unsigned long bit;
+		_BitScanReverse64(&bit, word);
+		return static_cast<int>(bit);
+#else
+		return 63 - __builtin_clzll(word);
+#endif
+	}
+
+	// Rounding towards minus infinity, for a positive denominator
+	int64_t FloorDiv(int64_t numerator, int64_t denominator) {
+		return numerator >= 0 ? numerator / denominator : -((denominator - 1 - numerator) / denominator);
+	}
+
+	int64_t CeilDiv(int64_t numerator, int64_t denominator) {
+		return -FloorDiv(-numerator, denominator);
+	}
+
+	// Narrows [first, last] to the x for which start + x * step is in
+	// [0, limit), exactly. Being linear, it's all in if both ends are.
+	void ClipSteps(int64_t start, int64_t step, int64_t limit, int64_t& first, int64_t& last) {
+		int64_t atFirst = start + first * step;
+		int64_t atLast = start + last * step;
+		if (atFirst >= 0 && atFirst < limit && atLast >= 0 && atLast < limit) {
+			return;
+		}
+		if (step > 0) {
+			first = std::max(first, CeilDiv(-start, step));
+			last = std::min(last, FloorDiv(limit - 1 - start, step));
+		}
+		else if (step < 0) {
+			first = std::max(first, CeilDiv(start - limit + 1, -step));
+			last = std::min(last, FloorDiv(start, -step));
+		}
+		else if (start < 0 || start >= limit) {
+			last = first - 1;
+		}
+	}
+
+	// Bits first to last of a word
+	uint64_t BitRange(int first, int last) {
+		return (~uint64_t(0) >> (63 - (last - first))) << first;
+	}
+
+	// Stretches shorter than this are sampled texel by texel
+	const int minWordStretch = 8;
+
+	// The sampled level's bits under grid texels first to last of a row,
+	// where texel x's centre lands at (u0 + x * du, v0 + x * dv), inside the
+	// level. Both the sampled line and the column offset (column - x) move
+	// monotonically along the row, so if they match at a stretch's ends
+	// they hold throughout, and the stretch is one shifted word: the whole
+	// row when the masks are near axis-aligned and at similar scale. Other
+	// stretches are halved until they are, or are short.
+	uint64_t SampleRow(const Level& sampled, int64_t u0, int64_t v0, int64_t du, int64_t dv, int first, int last) {
+		int64_t uFirst = u0 + first * du;
+		int64_t vFirst = v0 + first * dv;
+		if (last - first >= minWordStretch) {
+			int64_t uLast = u0 + last * du;
+			int64_t vLast = v0 + last * dv;
+			int64_t line = vFirst >> 16;
+			int64_t offset = (uFirst >> 16) - first;
+			if ((vLast >> 16) == line && (uLast >> 16) - last == offset) {
+				uint64_t word = sampled.rows[line];
+				uint64_t shifted = offset >= 0 ? word >> offset : word << -offset;
+				return shifted & BitRange(first, last);
+			}
+			int middle = first + (last - first) / 2;
+			return SampleRow(sampled, u0, v0, du, dv, first, middle) | SampleRow(sampled, u0, v0, du, dv, middle + 1, last);
+		}
+
+		uint64_t under = 0;
+		int64_t u = uFirst;
+		int64_t v = vFirst;
+		for (int x = first; x <= last; x++) {
+			uint64_t word = sampled.rows[v >> 16];
+			under |= ((word >> (u >> 16)) & 1) << x;
+			u += du;
+			v += dv;
+		}
+		return under;
+	}
+
+	// The world-space box around a quad, in Q16.16
+	struct Bounds {
+		int64_t minX, minY, maxX, maxY;
+	};
+
+	Bounds QuadBounds(const Pose& pose) {
+		int64_t extentX = std::abs(int64_t(pose.axisXx)) + std::abs(int64_t(pose.axisYx));
+		int64_t extentY = std::abs(int64_t(pose.axisXy)) + std::abs(int64_t(pose.axisYy));
+		return Bounds{ pose.x - extentX, pose.y - extentY, pose.x + extentX, pose.y + extentY };
+	}
+
+	// Whether a texel of `a` is smaller than one of `b`, comparing the longer
+	// side of each: |axis|^2 / size^2, cross-multiplied to stay in integers
+	bool Finer(const Pose& a, const Level& aLevel, const Pose& b, const Level& bLevel) {
+		auto side = [](const Pose& pose, const Level& level, int64_t& length2, int64_t& size2) {
+			int64_t x2 = int64_t(pose.axisXx) * pose.axisXx + int64_t(pose.axisXy) * pose.axisXy;
+			int64_t y2 = int64_t(pose.axisYx) * pose.axisYx + int64_t(pose.axisYy) * pose.axisYy;
+			int64_t w2 = int64_t(level.width) * level.width;
+			int64_t h2 = int64_t(level.height) * level.height;
+			bool longerX = x2 * h2 >= y2 * w2;
+			length2 = longerX ? x2 : y2;
+			size2 = longerX ? w2 : h2;
+		};
+		int64_t aLength2, aSize2, bLength2, bSize2;
+		side(a, aLevel, aLength2, aSize2);
+		side(b, bLevel, bLength2, bSize2);
+		return aLength2 * bSize2 < bLength2 * aSize2;
+	}
+}
+
+
+AlphaMask AlphaMask::fromPixels(const unsigned char* pixels, int width, int height, int channels) {
+	AlphaMask mask;
+	Level level;
+	level.width = width;
+	level.height = height;
+	int wordsPerRow = (width + 63) / 64;
+	level.rows.assign(size_t(wordsPerRow) * height, 0);
+	bool hasAlpha = channels == 2 || channels == 4;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const unsigned char* texel = pixels + (size_t(y) * width + x) * channels;
+			if (!hasAlpha || texel[channels - 1] >= minAlpha) {
+				level.rows[size_t(y) * wordsPerRow + x / 64] |= uint64_t(1) << (x % 64);
+			}
+		}
+	}
+	mask.levels.push_back(std::move(level));
+
+	// Each level ORs 2x2 blocks of the one before; odd sizes round up
+	while (mask.levels.back().width > 1 || mask.levels.back().height > 1) {
+		const Level& fine = mask.levels.back();
+		Level coarse;
+		coarse.width = (fine.width + 1) / 2;
+		coarse.height = (fine.height + 1) / 2;
+		int coarseWords = (coarse.width + 63) / 64;
+		coarse.rows.assign(size_t(coarseWords) * coarse.height, 0);
+		for (int y = 0; y < fine.height; y++) {
+			for (int x = 0; x < fine.width; x++) {
+				if (fine.test(x, y)) {
+					coarse.rows[size_t(y / 2) * coarseWords + (x / 2) / 64] |= uint64_t(1) << ((x / 2) % 64);
+				}
+			}
+		}
+		mask.levels.push_back(std::move(coarse));
+	}
+	return mask;
+}
+
+
+AlphaMask AlphaMask::load(const std::string& path) {
+	int width, height, channels;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+	if (data == nullptr) {
+		throw std::runtime_error("Failed to read texture data from file: " + path);
+	}
+	AlphaMask mask = fromPixels(data, width, height, channels);
+	stbi_image_free(data);
+	return mask;
+}
+
+
+const AlphaMask::Level& AlphaMask::testLevel() const {
+	for (const Level& level : levels) {
+		if (level.width <= maxTestSize && level.height <= maxTestSize) {
+			return level;
+		}
+	}
+	return levels.back();
+}
+
+
+bool AlphaMask::overlaps(const AlphaMask& a, const Pose& aPose, const AlphaMask& b, const Pose& bPose) {
+	if (a.empty() || b.empty()) return false;
+	Bounds aBounds = QuadBounds(aPose);
+	Bounds bBounds = QuadBounds(bPose);
+	if (aBounds.maxX < bBounds.minX || bBounds.maxX < aBounds.minX || aBounds.maxY < bBounds.minY || bBounds.maxY < aBounds.minY) {
+		return false;
+	}
+
+	// Rows of the finer mask (`grid`) get the coarser one (`sampled`) sampled
+	// at their texel centres
+	const Level* grid = &a.testLevel();
+	const Level* sampled = &b.testLevel();
+	const Pose* gridPose = &aPose;
+	const Pose* sampledPose = &bPose;
+	if (!Finer(aPose, *grid, bPose, *sampled)) {
+		std::swap(grid, sampled);
+		std::swap(gridPose, sampledPose);
+	}
+
+	TexelMap toSampled, toGrid;
+	if (!MapTexels(*gridPose, *grid, *sampledPose, *sampled, toSampled)
+		|| !MapTexels(*sampledPose, *sampled, *gridPose, *grid, toGrid)) {
+		return false;
+	}
+
+	// Only the grid's rows and columns under the sampled quad's corners
+	int64_t minU = INT64_MAX, minV = INT64_MAX, maxU = INT64_MIN, maxV = INT64_MIN;
+	for (int corner = 0; corner < 4; corner++) {
+		int64_t x = (corner & 1) ? sampled->width : 0;
+		int64_t y = (corner & 2) ? sampled->height : 0;
+		int64_t u = toGrid.originU + x * toGrid.uPerX + y * toGrid.uPerY;
+		int64_t v = toGrid.originV + x * toGrid.vPerX + y * toGrid.vPerY;
+		minU = std::min(minU, u);
+		maxU = std::max(maxU, u);
+		minV = std::min(minV, v);
+		maxV = std::max(maxV, v);
+	}
+	const int firstColumn = static_cast<int>(std::max<int64_t>(minU >> 16, 0));
+	const int lastColumn = static_cast<int>(std::min<int64_t>(maxU >> 16, grid->width - 1));
+	const int firstRow = static_cast<int>(std::max<int64_t>(minV >> 16, 0));
+	const int lastRow = static_cast<int>(std::min<int64_t>(maxV >> 16, grid->height - 1));
+	if (firstColumn > lastColumn || firstRow > lastRow) return false;
+	const uint64_t columns = BitRange(firstColumn, lastColumn);
+	const int64_t uLimit = int64_t(sampled->width) << 16;
+	const int64_t vLimit = int64_t(sampled->height) << 16;
+
+	for (int y = firstRow; y <= lastRow; y++) {
+		uint64_t row = grid->rows[y] & columns;
+		if (!row) continue;
+
+		// Texel centres step evenly along the row, so the stretch of it that
+		// lands inside the sampled quad is two linear bounds; only the drawn
+		// texels within that stretch need sampling
+		const int64_t u0 = toSampled.u(0, y);
+		const int64_t v0 = toSampled.v(0, y);
+		int64_t inFirst = LowestBit(row);
+		int64_t inLast = HighestBit(row);
+		ClipSteps(u0, toSampled.uPerX, uLimit, inFirst, inLast);
+		ClipSteps(v0, toSampled.vPerX, vLimit, inFirst, inLast);
+		if (inFirst > inLast) continue;
+		row &= BitRange(static_cast<int>(inFirst), static_cast<int>(inLast));
+		if (!row) continue;
+
+		uint64_t under = SampleRow(*sampled, u0, v0, toSampled.uPerX, toSampled.vPerX, LowestBit(row), HighestBit(row));
+		if (row & under) {
+			return true;
+		}
+	}
+	return false;
+}
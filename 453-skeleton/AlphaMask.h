@@ -0,0 +1,82 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Which texels of a sprite's texture are drawn: one bit per texel, set where
+// alpha is at least what test.frag keeps, for collision tests that follow the
+// sprite's outline instead of a circle.
+//
+// Rows are 64-bit words, bottom row first like the texture (images are
+// flipped on load), and bit x of a row is column x. Each mip level halves the
+// one before, a bit being set if any of the four under it is, down to 1x1:
+// a coarser level never misses anything a finer one has.
+//
+// overlaps() works in Q16.16 integers (see Fixed.h), so the simulation gets
+// the same answer on every machine.
+//
+// Example:
+//   AlphaMask ship = AlphaMask::load("textures/ship.png");
+//   AlphaMask::Pose pose{ x, y, axisXx, axisXy, axisYx, axisYy };
+//   bool hit = AlphaMask::overlaps(ship, pose, fire, firePose);
+//------------------------------------------------------------------------------
+
+#include "Fixed.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+class AlphaMask {
+
+public:
+	// Texels with less alpha are discarded by test.frag (0.01 of 255)
+	static const unsigned char minAlpha = 3;
+	// overlaps() tests the finest level no bigger than this either way: a
+	// row is then one word, and a pair samples at most 32x32 texels
+	static const int maxTestSize = 32;
+
+	// Where a sprite's quad is: its centre and the world vectors its local
+	// x and y axes (the quad spans -1 to 1) end up as, in Q16.16, as in
+	// Affine2D
+	struct Pose {
+		Fixed::Q x, y;
+		Fixed::Q axisXx, axisXy;
+		Fixed::Q axisYx, axisYy;
+	};
+
+	struct Level {
+		int width = 0;
+		int height = 0;
+		std::vector<uint64_t> rows;		// ((width + 63) / 64) words per row
+
+		bool test(int x, int y) const {
+			int wordsPerRow = (width + 63) / 64;
+			return (rows[y * wordsPerRow + x / 64] >> (x % 64)) & 1;
+		}
+	};
+
+	AlphaMask() = default;
+
+	// From `channels` bytes per texel, alpha last; without an alpha channel
+	// every texel is opaque
+	static AlphaMask fromPixels(const unsigned char* pixels, int width, int height, int channels);
+	// Reads an image file the way Texture does, without needing OpenGL
+	static AlphaMask load(const std::string& path);
+
+	// Public interface
+	bool empty() const { return levels.empty(); }
+	int levelCount() const { return static_cast<int>(levels.size()); }
+	const Level& level(int i) const { return levels[i]; }
+
+	// Whether any drawn texel of `a` covers a drawn texel of `b`. Samples the
+	// coarser of the two at the texel centres of the finer, a row at a time,
+	// and ANDs the rows as words. The sprites must be within a few units of
+	// each other, as hit test candidates are.
+	static bool overlaps(const AlphaMask& a, const Pose& aPose, const AlphaMask& b, const Pose& bPose);
+
+private:
+	std::vector<Level> levels;
+
+	// The finest level within maxTestSize
+	const Level& testLevel() const;
+};
@@ -0,0 +1,115 @@
+#include "Bench.h"
+
+#include "Log.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+namespace {
+	// One sweep of the turn target every this many ticks
+	const double sweepTicks = 4000.0;
+	const float sweepRadius = 0.8f;
+
+	struct Summary {
+		double mean = 0.0;
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	Summary Summarize(std::vector<double> values) {
+		Summary summary;
+		if (values.empty()) return summary;
+		std::sort(values.begin(), values.end());
+		auto at = [&](double p) {
+			return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+		};
+		double total = 0.0;
+		for (double value : values) {
+			total += value;
+		}
+		summary.mean = total / values.size();
+		summary.p50 = at(0.50);
+		summary.p95 = at(0.95);
+		summary.p99 = at(0.99);
+		summary.max = values.back();
+		return summary;
+	}
+
+	void WriteSummary(fmt::memory_buffer& out, const char* name, const Summary& s) {
+		fmt::format_to(out, "  \"{}\": {{ \"mean\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f} }},\n",
+			name, s.mean, s.p50, s.p95, s.p99, s.max);
+	}
+}
+
+
+TickInput BenchInput(uint64_t tick) {
+	const double twoPi = 6.283185307179586;
+	double angle = twoPi * std::fmod(static_cast<double>(tick), sweepTicks) / sweepTicks;
+	TickInput input;
+	input.moveForward = true;
+	input.turning = true;
+	input.target = glm::vec2(sweepRadius * std::cos(angle), sweepRadius * std::sin(angle));
+	return input;
+}
+
+
+BenchReport::BenchReport(const BenchConfig& config)
+	: config(config)
+{
+	frames.reserve(config.frames);
+}
+
+
+void BenchReport::addFrame(const Frame& frame) {
+	frames.push_back(frame);
+}
+
+
+bool BenchReport::write(const std::string& path, uint64_t ticks, int32_t score) const {
+	std::vector<double> frameMs, simMs, renderMs, allocations, allocatedBytes;
+	double totalMs = 0.0;
+	uint64_t totalAllocations = 0;
+	for (const Frame& frame : frames) {
+		frameMs.push_back(frame.frameMs);
+		simMs.push_back(frame.simMs);
+		renderMs.push_back(frame.renderMs);
+		allocations.push_back(static_cast<double>(frame.allocations));
+		allocatedBytes.push_back(static_cast<double>(frame.allocatedBytes));
+		totalMs += frame.frameMs;
+		totalAllocations += frame.allocations;
+	}
+
+	fmt::memory_buffer out;
+	fmt::format_to(out, "{{\n");
+	fmt::format_to(out, "  \"entities\": {},\n  \"seed\": {},\n  \"frames\": {},\n  \"ticks\": {},\n  \"ticks_per_second\": {},\n  \"ticks_per_frame\": {},\n",
+		config.entities, config.seed, frames.size(), ticks, config.ticksPerSecond, config.ticksPerFrame);
+	fmt::format_to(out, "  \"threads\": {},\n  \"simd\": \"{}\",\n  \"fixed_point\": {},\n  \"headless\": {},\n  \"vsync\": {},\n  \"sprite_mesh\": \"{}\",\n",
+		config.threads, config.simd, config.fixedPoint, config.headless, config.vsync, config.spriteMesh);
+	WriteSummary(out, "frame_ms", Summarize(frameMs));
+	WriteSummary(out, "sim_ms", Summarize(simMs));
+	WriteSummary(out, "render_ms", Summarize(renderMs));
+	WriteSummary(out, "allocations_per_frame", Summarize(allocations));
+	WriteSummary(out, "allocated_bytes_per_frame", Summarize(allocatedBytes));
+	fmt::format_to(out, "  \"total_allocations\": {},\n  \"total_s\": {:.4f},\n  \"final_score\": {}\n}}\n",
+		totalAllocations, totalMs / 1000.0, score);
+
+	std::FILE* file = path.empty() ? stdout : std::fopen(path.c_str(), "w");
+	if (!file) {
+		Log::error("BENCH couldn't write the report to {}", path);
+		return false;
+	}
+	std::fwrite(out.data(), 1, out.size(), file);
+	if (file == stdout) {
+		std::fflush(file);
+	}
+	else {
+		std::fclose(file);
+	}
+	return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Benchmark mode: a scripted player drives a generated level for a fixed
+// number of frames, and BenchReport turns the per-frame timings and heap
+// allocations into JSON.
+//
+// The level, the input and the number of ticks per frame depend only on the
+// configuration, so two builds run exactly the same workload and their
+// reports can be compared directly.
+//
+// Example:
+//   453-skeleton --bench --entities=20000 --frames=2000 --seed=7 --headless
+//------------------------------------------------------------------------------
+
+#include "TickInput.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct BenchConfig {
+	uint32_t entities = 0;
+	uint64_t seed = 0;
+	uint32_t frames = 0;
+	uint32_t ticksPerSecond = 0;
+	uint32_t ticksPerFrame = 0;
+	unsigned threads = 0;
+	std::string simd;		// which sprite kernels ran (see SpriteKernels.h)
+	bool fixedPoint = false;	// Game::Arithmetic::FixedPoint
+	bool headless = false;
+	bool vsync = false;
+	std::string spriteMesh;	// --sprite-mesh
+};
+
+
+// Input for the given tick: always flying forward while the turn target
+// sweeps around a circle, so the ship keeps crossing the level
+TickInput BenchInput(uint64_t tick);
+
+
+class BenchReport {
+
+public:
+	struct Frame {
+		double frameMs = 0.0;
+		double simMs = 0.0;
+		double renderMs = 0.0;	// building draw data (and issuing GL calls, when windowed)
+		uint64_t allocations = 0;
+		uint64_t allocatedBytes = 0;
+	};
+
+	explicit BenchReport(const BenchConfig& config);
+
+	// Public interface
+	void addFrame(const Frame& frame);
+
+	// Writes the report to `path`, or stdout if empty. Returns false if the file can't be written.
+	bool write(const std::string& path, uint64_t ticks, int32_t score) const;
+
+	size_t getFrameCount() const { return frames.size(); }
+
+private:
+	BenchConfig config;
+	std::vector<Frame> frames;
+};
@@ -0,0 +1,184 @@
+#include "BinaryLog.h"
+
+#include <chrono>
+
+
+namespace {
+	using BinaryLog::Entry;
+
+	// Longer strings, or any once the table is full, are written inline every time
+	const size_t maxInternedLength = 256;
+	const size_t maxInternedStrings = 4096;
+
+	uint64_t wallClockNow() {
+		auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch).count();
+	}
+}
+
+
+bool BinaryLogWriter::open(const std::string& path) {
+	if (!file.open(path)) {
+		return false;
+	}
+	lastTime = Log::detail::now();
+	uint64_t wallClock = wallClockNow();
+	putBytes(message, BinaryLog::magic, sizeof(BinaryLog::magic));
+	putBytes(message, &BinaryLog::version, sizeof(BinaryLog::version));
+	putBytes(message, &wallClock, sizeof(wallClock));
+	putBytes(message, &lastTime, sizeof(lastTime));
+	flush();
+	return true;
+}
+
+
+void BinaryLogWriter::close() {
+	file.close();
+	formats.clear();
+	strings.clear();
+	internedText.clear();
+}
+
+
+void BinaryLogWriter::write(const Log::detail::Record& record) {
+	// Records carry copies of their format strings, so they're told apart by
+	// content
+	auto format = formats.find(record.formatString());
+	if (format == formats.end()) {
+		const std::string& text = internedText.emplace_back(record.formatString());
+		format = formats.emplace(std::string_view(text), static_cast<uint32_t>(formats.size())).first;
+		putByte(definitions, static_cast<uint8_t>(Entry::Format));
+		putVarint(definitions, format->second);
+		putVarint(definitions, text.size());
+		putBytes(definitions, text.data(), text.size());
+	}
+
+	putByte(message, static_cast<uint8_t>(Entry::Message));
+	putByte(message, static_cast<uint8_t>(record.level));
+	putTime(record.time);
+	putVarint(message, format->second);
+	size_t countAt = message.size();
+	putByte(message, 0);
+
+	argCount = 0;
+	record.serialize(*this, record);
+	message[countAt] = argCount;
+	flush();
+}
+
+
+void BinaryLogWriter::writeText(Log::Level level, uint64_t time, std::string_view text) {
+	putByte(message, static_cast<uint8_t>(Entry::Text));
+	putByte(message, static_cast<uint8_t>(level));
+	putTime(time);
+	putVarint(message, text.size());
+	putBytes(message, text.data(), text.size());
+	flush();
+}
+
+
+void BinaryLogWriter::writeDropped(uint64_t count) {
+	putByte(message, static_cast<uint8_t>(Entry::Dropped));
+	putVarint(message, count);
+	flush();
+}
+
+
+void BinaryLogWriter::putBool(bool value) {
+	putArg(Arg::Bool);
+	putByte(message, value ? 1 : 0);
+}
+
+
+void BinaryLogWriter::putChar(char value) {
+	putArg(Arg::Char);
+	putByte(message, static_cast<uint8_t>(value));
+}
+
+
+void BinaryLogWriter::putSigned(int64_t value) {
+	putArg(Arg::Signed);
+	putVarint(message, BinaryLog::zigzag(value));
+}
+
+
+void BinaryLogWriter::putUnsigned(uint64_t value) {
+	putArg(Arg::Unsigned);
+	putVarint(message, value);
+}
+
+
+void BinaryLogWriter::putFloat(float value) {
+	putArg(Arg::Float);
+	putBytes(message, &value, sizeof(value));
+}
+
+
+void BinaryLogWriter::putDouble(double value) {
+	putArg(Arg::Double);
+	putBytes(message, &value, sizeof(value));
+}
+
+
+void BinaryLogWriter::putString(std::string_view value) {
+	auto found = strings.find(value);
+	if (found == strings.end() && value.size() <= maxInternedLength && strings.size() < maxInternedStrings) {
+		uint32_t id = static_cast<uint32_t>(strings.size());
+		const std::string& text = internedText.emplace_back(value);
+		found = strings.emplace(std::string_view(text), id).first;
+		putByte(definitions, static_cast<uint8_t>(Entry::String));
+		putVarint(definitions, id);
+		putVarint(definitions, text.size());
+		putBytes(definitions, text.data(), text.size());
+	}
+
+	if (found != strings.end()) {
+		putArg(Arg::String);
+		putVarint(message, found->second);
+	}
+	else {
+		putArg(Arg::InlineString);
+		putVarint(message, value.size());
+		putBytes(message, value.data(), value.size());
+	}
+}
+
+
+void BinaryLogWriter::putByte(Buffer& buffer, uint8_t value) {
+	buffer.push_back(value);
+}
+
+
+void BinaryLogWriter::putVarint(Buffer& buffer, uint64_t value) {
+	while (value >= 0x80) {
+		buffer.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+
+void BinaryLogWriter::putBytes(Buffer& buffer, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+
+void BinaryLogWriter::putTime(uint64_t time) {
+	putVarint(message, BinaryLog::zigzag(static_cast<int64_t>(time - lastTime)));
+	lastTime = time;
+}
+
+
+void BinaryLogWriter::putArg(Arg tag) {
+	argCount++;
+	putByte(message, static_cast<uint8_t>(tag));
+}
+
+
+void BinaryLogWriter::flush() {
+	file.append(definitions.data(), definitions.size());
+	file.append(message.data(), message.size());
+	definitions.clear();
+	message.clear();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Writes queued log lines to a binary file instead of formatting them.
+//
+// A line becomes its format string's id plus the raw argument values. Format
+// strings, and short string arguments, are written once and referred to by id
+// afterwards, so a typical line takes a dozen bytes or so instead of a hundred.
+// tools/logdecode turns a file back into text or JSON; BinaryLogFormat.h
+// describes the layout.
+//
+// Only the async logger's writer thread uses this (see Log::startAsync()).
+//------------------------------------------------------------------------------
+
+#include "BinaryLogFormat.h"
+#include "Log.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+class BinaryLogWriter : public Log::detail::ArgSink {
+	using Arg = BinaryLog::Arg;
+
+public:
+	// Public interface
+	bool open(const std::string& path);
+	void close();
+
+	void write(const Log::detail::Record& record);
+	void writeText(Log::Level level, uint64_t time, std::string_view text);
+	void writeDropped(uint64_t count);
+
+	// ArgSink
+	void putBool(bool value) override;
+	void putChar(char value) override;
+	void putSigned(int64_t value) override;
+	void putUnsigned(uint64_t value) override;
+	void putFloat(float value) override;
+	void putDouble(double value) override;
+	void putString(std::string_view value) override;
+
+private:
+	using Buffer = std::vector<uint8_t>;
+
+	MappedFile file;
+	// Entries are built here and appended to the file in one go. Arguments may
+	// define new strings, which have to come before the message using them.
+	Buffer definitions;
+	Buffer message;
+	uint8_t argCount = 0;
+	uint64_t lastTime = 0;
+
+	std::unordered_map<std::string_view, uint32_t> formats; // views into internedText
+	std::unordered_map<std::string_view, uint32_t> strings; // views into internedText
+	std::deque<std::string> internedText;
+
+	static void putByte(Buffer& buffer, uint8_t value);
+	static void putVarint(Buffer& buffer, uint64_t value);
+	static void putBytes(Buffer& buffer, const void* data, size_t size);
+	void putTime(uint64_t time);
+	void putArg(Arg tag);
+	void flush();
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Layout of binary log files, shared by the game and tools/logdecode.
+//
+// Header:
+//   char[4]  "SSBL"
+//   uint32   version
+//   uint64   wall clock at startup, nanoseconds since the Unix epoch
+//   uint64   steady clock at startup, nanoseconds (message times use this clock)
+//
+// Then entries, each starting with an Entry byte. A zero byte marks the end of
+// the data; the file is grown in chunks of zeros, so a crashed session still
+// decodes up to its last complete entry.
+//
+//   Format   varint id, varint length, bytes       defines a format string
+//   String   varint id, varint length, bytes       defines an interned string
+//   Message  uint8 level, zigzag varint time delta, varint format id,
+//            uint8 argument count, then per argument an Arg byte and its value
+//   Text     uint8 level, zigzag varint time delta, varint length, bytes
+//            (a line the game had to format itself)
+//   Dropped  varint number of lines lost to full buffers
+//
+// Time deltas are relative to the previous Message or Text entry. Lines from
+// different threads are written in batches, so a delta may be negative.
+//
+// Argument values: Bool and Char are one byte, Signed is a zigzag varint,
+// Unsigned a varint, Float and Double little-endian IEEE floats, String a
+// varint id of an interned string, and InlineString a varint length plus bytes.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+
+
+namespace BinaryLog {
+	const char magic[4] = { 'S', 'S', 'B', 'L' };
+	const uint32_t version = 1;
+
+	enum class Entry : uint8_t {
+		End = 0,
+		Format = 1,
+		String = 2,
+		Message = 3,
+		Text = 4,
+		Dropped = 5,
+	};
+
+	enum class Arg : uint8_t {
+		Bool,
+		Char,
+		Signed,
+		Unsigned,
+		Float,
+		Double,
+		String,
+		InlineString,
+	};
+
+	// Same order as Log::Level
+	const char* const levelNames[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+	const uint8_t levelCount = 4;
+
+	inline uint64_t zigzag(int64_t value) {
+		return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+	}
+
+	inline int64_t unzigzag(uint64_t value) {
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+}
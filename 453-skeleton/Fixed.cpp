@@ -0,0 +1,142 @@
+#include "Fixed.h"
+
+
+namespace {
+	// The tables are built in Q2.30, with int64 intermediates, so their
+	// rounding stays far below Q16.16's
+	const int tableBits = 30;
+	const int64_t halfPi30 = 1686629713;	// round(PI / 2 * 2^30)
+	const int64_t quarterPi30 = 843314857;
+
+	// sin(x) for 0 <= x <= PI / 2 from its Taylor series, which is within
+	// 2^-38 after the x^15 term
+	constexpr int64_t TaylorSin(int64_t x) {
+		int64_t x2 = (x * x) >> tableBits;
+		int64_t term = x;
+		int64_t sum = x;
+		for (int64_t k = 1; k <= 7; k++) {
+			term = -((term * x2) >> tableBits) / ((2 * k) * (2 * k + 1));
+			sum += term;
+		}
+		return sum;
+	}
+
+	// atan(x) for 0 <= x <= 1 / 2 from its Taylor series
+	constexpr int64_t TaylorAtan(int64_t x) {
+		int64_t x2 = (x * x) >> tableBits;
+		int64_t power = x;
+		int64_t sum = x;
+		for (int64_t k = 1; k <= 16; k++) {
+			power = -((power * x2) >> tableBits);
+			sum += power / (2 * k + 1);
+		}
+		return sum;
+	}
+
+	// A quarter of a sine wave in sineSteps steps, linearly interpolated
+	// between: within 5e-6 of the curve. One entry past the end, so
+	// interpolating from the last step reads nothing out of range.
+	const int sineStepBits = 8;
+	const int sineSteps = 1 << sineStepBits;
+	struct SineTable {
+		int32_t values[sineSteps + 2];
+	};
+
+	constexpr SineTable MakeSineTable() {
+		SineTable table{};
+		for (int i = 0; i <= sineSteps; i++) {
+			table.values[i] = static_cast<int32_t>(TaylorSin(halfPi30 * i / sineSteps));
+		}
+		table.values[sineSteps + 1] = table.values[sineSteps];
+		return table;
+	}
+
+	constexpr SineTable sineTable = MakeSineTable();
+
+	// atan(2^-i): how far CORDIC step i turns
+	const int cordicSteps = 24;
+	struct CordicTable {
+		int32_t angles[cordicSteps];
+	};
+
+	constexpr CordicTable MakeCordicTable() {
+		CordicTable table{};
+		table.angles[0] = static_cast<int32_t>(quarterPi30);
+		for (int i = 1; i < cordicSteps; i++) {
+			table.angles[i] = static_cast<int32_t>(TaylorAtan((int64_t(1) << tableBits) >> i));
+		}
+		return table;
+	}
+
+	constexpr CordicTable cordicTable = MakeCordicTable();
+
+	// From Q2.30 back to Q16.16, rounded to nearest
+	Fixed::Q FromTable(int64_t value) {
+		const int shift = tableBits - Fixed::fractionBits;
+		return static_cast<Fixed::Q>((value + (int64_t(1) << (shift - 1))) >> shift);
+	}
+
+	// The sine of a binary angle, where 2^32 is a full turn, in Q2.30
+	int64_t SineOfTurn(uint32_t turn) {
+		uint32_t quadrant = turn >> 30;
+		uint32_t within = turn & 0x3FFFFFFF;
+		if (quadrant & 1) {
+			within = 0x40000000 - within;
+		}
+		const int fractionShift = 30 - sineStepBits - 16;
+		uint32_t step = within >> (30 - sineStepBits);
+		int64_t fraction = (within >> fractionShift) & 0xFFFF;
+		int64_t low = sineTable.values[step];
+		int64_t high = sineTable.values[step + 1];
+		int64_t value = low + (((high - low) * fraction) >> 16);
+		return quadrant & 2 ? -value : value;
+	}
+
+	// Radians to a binary angle, wrapping whole turns away. The factor is
+	// 2^32 / (2 PI), in Q16.16 units and scaled by 2^16.
+	uint32_t ToTurn(Fixed::Q angle) {
+		const int64_t turnsPerRadian = 683565276;
+		return static_cast<uint32_t>((static_cast<int64_t>(angle) * turnsPerRadian) >> 16);
+	}
+}
+
+
+namespace Fixed {
+	Q sin(Q angle) {
+		return FromTable(SineOfTurn(ToTurn(angle)));
+	}
+
+	Q cos(Q angle) {
+		return FromTable(SineOfTurn(ToTurn(angle) + 0x40000000u));
+	}
+
+	Q atan2(Q y, Q x) {
+		if (x == 0 && y == 0) return 0;
+
+		// CORDIC: turn (x, y) onto the positive x axis in steps of atan(2^-i),
+		// adding up the turns. Scaled up first so the halving keeps precision.
+		int64_t vx = static_cast<int64_t>(x) << 14;
+		int64_t vy = static_cast<int64_t>(y) << 14;
+		int64_t angle = 0;
+		if (vx < 0) {
+			vx = -vx;
+			vy = -vy;
+			angle = y >= 0 ? 2 * halfPi30 : -2 * halfPi30;
+		}
+		for (int i = 0; i < cordicSteps; i++) {
+			int64_t dx = vx >> i;
+			int64_t dy = vy >> i;
+			if (vy > 0) {
+				vx += dy;
+				vy -= dx;
+				angle += cordicTable.angles[i];
+			}
+			else {
+				vx -= dy;
+				vy += dx;
+				angle -= cordicTable.angles[i];
+			}
+		}
+		return FromTable(angle);
+	}
+}
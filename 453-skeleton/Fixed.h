@@ -0,0 +1,60 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Q16.16 fixed point: a real number v held as the integer round(v * 65536).
+//
+// Integer arithmetic gives the same bits with every compiler, optimization
+// flag and CPU, which float arithmetic doesn't (FMA contraction, -ffast-math,
+// differing libm). The trigonometry here is integer too: sin and cos
+// interpolate a quarter-wave table, atan2 runs CORDIC, and both tables are
+// computed at compile time with integer arithmetic.
+//
+// Every Q16.16 value of magnitude below 256 is exactly a float, so values can
+// be kept in float storage and converted back with no loss (see load()).
+//
+// Example:
+//   Fixed::Q heading = Fixed::atan2(Fixed::fromFloat(dy), Fixed::fromFloat(dx));
+//   float x = Fixed::toFloat(Fixed::mul(speed, Fixed::cos(heading)));
+//------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+
+
+namespace Fixed {
+	using Q = int32_t;
+
+	const int fractionBits = 16;
+	const Q one = 1 << fractionBits;
+	const Q pi = 205887;			// round(PI * 65536)
+	const Q twoPi = 411775;
+
+	// Rounded to the nearest Q16.16 value
+	inline Q fromFloat(float value) {
+		return static_cast<Q>(std::lround(value * static_cast<float>(one)));
+	}
+
+	// Exact while |value| < 256
+	inline float toFloat(Q value) {
+		return static_cast<float>(value) * (1.f / static_cast<float>(one));
+	}
+
+	// fromFloat() for a float known to be a Q16.16 value already, as toFloat()
+	// makes them: exact, and cheap enough to vectorize
+	inline Q load(float value) {
+		return static_cast<Q>(value * static_cast<float>(one));
+	}
+
+	// a * b, rounded to nearest. (Right shifts of negative numbers are
+	// arithmetic on every compiler we build with.)
+	inline Q mul(Q a, Q b) {
+		return static_cast<Q>((static_cast<int64_t>(a) * b + (one >> 1)) >> fractionBits);
+	}
+
+	// Any angle in radians; within 1/65536 of the true value
+	Q sin(Q angle);
+	Q cos(Q angle);
+
+	// In (-pi, pi], and 0 for (0, 0); within 1/65536 of the true value
+	Q atan2(Q y, Q x);
+}
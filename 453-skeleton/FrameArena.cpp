@@ -0,0 +1,85 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+namespace {
+	size_t alignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// The block itself is aligned to this, so offsets aligned to anything up
+	// to it give aligned addresses
+	const size_t blockAlignment = 64;
+}
+
+
+FrameArena::FrameArena(size_t capacity)
+	: block(static_cast<std::byte*>(::operator new(capacity, std::align_val_t(blockAlignment))))
+	, capacity(capacity)
+{}
+
+
+FrameArena::~FrameArena() {
+	freeOverflow();
+	::operator delete(block, std::align_val_t(blockAlignment));
+}
+
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	live.fetch_add(1, std::memory_order_relaxed);
+	if (alignment <= blockAlignment) {
+		size_t current = used.load(std::memory_order_relaxed);
+		size_t start, end;
+		do {
+			start = alignUp(current, alignment);
+			end = start + size;
+			if (end > capacity) {
+				return allocateOverflow(size, alignment);
+			}
+		} while (!used.compare_exchange_weak(current, end, std::memory_order_relaxed));
+		return block + start;
+	}
+	return allocateOverflow(size, alignment);
+}
+
+
+void* FrameArena::allocateOverflow(size_t size, size_t alignment) {
+	alignment = std::max(alignment, alignof(std::max_align_t));
+	void* pointer = ::operator new(size, std::align_val_t(alignment));
+	std::lock_guard<std::mutex> lock(overflowMutex);
+	overflow.push_back({ pointer, alignment });
+	overflowBytes += size + alignment;
+	return pointer;
+}
+
+
+void FrameArena::freeOverflow() {
+	for (const Overflow& o : overflow) {
+		::operator delete(o.pointer, std::align_val_t(o.alignment));
+	}
+	overflow.clear();
+}
+
+
+bool FrameArena::reset() {
+	if (live.load(std::memory_order_acquire) != 0) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(overflowMutex);
+	if (!overflow.empty()) {
+		freeOverflow();
+
+		// Grow so that a frame like this one fits next time
+		size_t needed = used.load(std::memory_order_relaxed) + overflowBytes;
+		size_t grown = std::max(capacity * 2, alignUp(needed, blockAlignment));
+		::operator delete(block, std::align_val_t(blockAlignment));
+		block = static_cast<std::byte*>(::operator new(grown, std::align_val_t(blockAlignment)));
+		capacity = grown;
+		overflowBytes = 0;
+	}
+	used.store(0, std::memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A linear (bump) allocator for data that only lives for one frame or tick.
+//
+// Allocating is a pointer bump; freeing does nothing until reset() hands the
+// whole block back at once. Any thread may allocate. When a frame needs more
+// than the block holds, the excess comes from the heap and reset() grows the
+// block to fit, so after a few frames a steady workload stops touching the
+// heap entirely.
+//
+// ArenaAllocator adapts an arena for standard containers and
+// std::allocate_shared:
+//
+//   FrameArena arena(64 * 1024);
+//   std::vector<int, ArenaAllocator<int>> scratch{ ArenaAllocator<int>(&arena) };
+//   ...
+//   scratch = {};		// or let it go out of scope
+//   arena.reset();
+//
+// reset() refuses (and returns false) while anything allocated from the arena
+// hasn't been released yet, so memory is never reused under a live object.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+
+
+class FrameArena {
+
+public:
+	explicit FrameArena(size_t capacity);
+	~FrameArena();
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena operator=(const FrameArena&) = delete;
+
+	// Public interface
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	void release() { live.fetch_sub(1, std::memory_order_release); }
+
+	// Makes all memory available again. False if allocations are still live.
+	bool reset();
+
+	size_t getCapacity() const { return capacity; }
+	size_t getUsed() const { return used.load(std::memory_order_relaxed) + overflowBytes; }
+
+private:
+	std::byte* block;
+	size_t capacity;
+	std::atomic<size_t> used{ 0 };
+	std::atomic<size_t> live{ 0 };
+
+	struct Overflow {
+		void* pointer;
+		size_t alignment;
+	};
+
+	std::mutex overflowMutex; // guards everything below
+	std::vector<Overflow> overflow;
+	size_t overflowBytes = 0;
+
+	void* allocateOverflow(size_t size, size_t alignment);
+	void freeOverflow();
+};
+
+
+// Allocates from an arena, or from the heap when constructed without one
+template <typename T>
+class ArenaAllocator {
+
+public:
+	using value_type = T;
+
+	ArenaAllocator() = default;
+	explicit ArenaAllocator(FrameArena* arena) : arena(arena) {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+	T* allocate(size_t n) {
+		if (arena) {
+			return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+		}
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T* pointer, size_t) {
+		if (arena) {
+			arena->release();
+		}
+		else {
+			::operator delete(pointer);
+		}
+	}
+
+	FrameArena* getArena() const { return arena; }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.getArena(); }
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.getArena(); }
+
+private:
+	FrameArena* arena = nullptr;
+};
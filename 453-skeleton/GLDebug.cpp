@@ -1,81 +1,208 @@
 #include "GLDebug.h"
 #include "Log.h"
 
-#include <regex>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	// Logged in full before rate limiting kicks in
+	const unsigned burstSize = 3;
+	// After the burst, an id is logged at most this often
+	const std::chrono::seconds repeatInterval(1);
+	// How often update() logs the summary table, if anything new arrived
+	const std::chrono::seconds summaryInterval(5);
+
+	struct MessageStats {
+		GLenum source;
+		GLenum type;
+		GLenum severity;
+		std::string text;			// the first message seen with this id
+		unsigned long long count = 0;
+		unsigned long long suppressed = 0; // since the id was last logged
+		Clock::time_point lastLogged;
+	};
+
+	// The handler can be called from driver threads when output is asynchronous
+	std::mutex statsMutex;
+	std::unordered_map<GLuint, MessageStats> stats;
+	bool newSinceSummary = false;
+	Clock::time_point lastSummary = Clock::now();
+
+
+	const char* sourceName(GLenum source) {
+		switch (source)
+		{
+			case GL_DEBUG_SOURCE_API:             return "API";
+			case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "Window System";
+			case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+			case GL_DEBUG_SOURCE_THIRD_PARTY:     return "Third Party";
+			case GL_DEBUG_SOURCE_APPLICATION:     return "Application";
+			case GL_DEBUG_SOURCE_OTHER:           return "Other";
+		}
+		return "";
+	}
+
+	const char* typeName(GLenum type) {
+		switch (type)
+		{
+			case GL_DEBUG_TYPE_ERROR:               return "Error";
+			case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated Behaviour";
+			case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "Undefined Behaviour";
+			case GL_DEBUG_TYPE_PORTABILITY:         return "Portability";
+			case GL_DEBUG_TYPE_PERFORMANCE:         return "Performance";
+			case GL_DEBUG_TYPE_MARKER:              return "Marker";
+			case GL_DEBUG_TYPE_PUSH_GROUP:          return "Push Group";
+			case GL_DEBUG_TYPE_POP_GROUP:           return "Pop Group";
+			case GL_DEBUG_TYPE_OTHER:               return "Other";
+		}
+		return "";
+	}
+
+	const char* severityName(GLenum severity) {
+		switch (severity)
+		{
+			case GL_DEBUG_SEVERITY_HIGH:         return "high";
+			case GL_DEBUG_SEVERITY_MEDIUM:       return "medium";
+			case GL_DEBUG_SEVERITY_LOW:          return "low";
+			case GL_DEBUG_SEVERITY_NOTIFICATION: return "";
+		}
+		return "";
+	}
+
+	std::string_view trim(const char* message, GLsizei length) {
+		std::string_view text(message, length >= 0 ? static_cast<size_t>(length) : std::strlen(message));
+		const char* whitespace = " \t\r\n";
+		size_t first = text.find_first_not_of(whitespace);
+		if (first == std::string_view::npos) {
+			return std::string_view();
+		}
+		size_t last = text.find_last_not_of(whitespace);
+		return text.substr(first, last - first + 1);
+	}
+
+	void logMessage(GLenum source, GLenum type, GLuint id, GLenum severity, std::string_view text, unsigned long long suppressed) {
+		const char* format = "[OPENGL] [{}] {} #{} -- {}: {}{}";
+		std::string repeats = suppressed ? fmt::format(" ({} repeats suppressed)", suppressed) : std::string();
+		const char* sourceStr = sourceName(source);
+		const char* severityStr = severityName(severity);
+		const char* typeStr = typeName(type);
+		switch (severity)
+		{
+			case GL_DEBUG_SEVERITY_HIGH:
+				Log::error(format, sourceStr, severityStr, id, typeStr, text, repeats);
+				break;
+			case GL_DEBUG_SEVERITY_MEDIUM:
+				Log::warn(format, sourceStr, severityStr, id, typeStr, text, repeats);
+				break;
+			case GL_DEBUG_SEVERITY_LOW:
+				Log::info(format, sourceStr, severityStr, id, typeStr, text, repeats);
+				break;
+			case GL_DEBUG_SEVERITY_NOTIFICATION:
+				LOG_DEBUG(format, sourceStr, severityStr, id, typeStr, text, repeats);
+				break;
+		}
+	}
+}
+
 
 void GLDebug::debugOutputHandler(
 	GLenum source,
 	GLenum type,
 	GLuint id,
 	GLenum severity,
-	GLsizei,
+	GLsizei length,
 	const GLchar *message,
 	const void *
 ) {
     // ignore non-significant error/warning codes
     //if(id == 131169 || id == 131185 || id == 131218 || id == 131204) return;
 
-    std::string sourceStr, typeStr, severityStr;
-
-    switch (source)
-    {
-        case GL_DEBUG_SOURCE_API:             sourceStr = "API"; break;
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   sourceStr = "Window System"; break;
-        case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceStr = "Shader Compiler"; break;
-        case GL_DEBUG_SOURCE_THIRD_PARTY:     sourceStr = "Third Party"; break;
-        case GL_DEBUG_SOURCE_APPLICATION:     sourceStr = "Application"; break;
-        case GL_DEBUG_SOURCE_OTHER:           sourceStr = "Other"; break;
-    }
-
-    switch (type)
-    {
-        case GL_DEBUG_TYPE_ERROR:               typeStr = "Error"; break;
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeStr = "Deprecated Behaviour"; break;
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  typeStr = "Undefined Behaviour"; break;
-        case GL_DEBUG_TYPE_PORTABILITY:         typeStr = "Portability"; break;
-        case GL_DEBUG_TYPE_PERFORMANCE:         typeStr = "Performance"; break;
-        case GL_DEBUG_TYPE_MARKER:              typeStr = "Marker"; break;
-        case GL_DEBUG_TYPE_PUSH_GROUP:          typeStr = "Push Group"; break;
-        case GL_DEBUG_TYPE_POP_GROUP:           typeStr = "Pop Group"; break;
-        case GL_DEBUG_TYPE_OTHER:               typeStr = "Other"; break;
-    }
-
-    std::string format = "[OPENGL] [{}] {} #{} -- {}: {}";
-    std::string message_str = message;
-    message_str = std::regex_replace(message_str, std::regex("^\\s+|\\s+$"), "$1");
-    switch (severity)
-    {
-        case GL_DEBUG_SEVERITY_HIGH:
-            severityStr = "high";
-			Log::error(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_MEDIUM:
-            severityStr = "medium";
-			Log::warn(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_LOW:
-            severityStr = "low";
-			Log::info(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_NOTIFICATION:
-			Log::debug(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-    }
+	Clock::time_point now = Clock::now();
+	unsigned long long suppressed = 0;
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		newSinceSummary = true;
+		MessageStats& entry = stats[id];
+		entry.count++;
+		if (entry.count == 1) {
+			entry.source = source;
+			entry.type = type;
+			entry.severity = severity;
+			entry.text = trim(message, length);
+		}
+		if (entry.count > burstSize && now - entry.lastLogged < repeatInterval) {
+			entry.suppressed++;
+			return;
+		}
+		entry.lastLogged = now;
+		suppressed = entry.suppressed;
+		entry.suppressed = 0;
+	}
+	logMessage(source, type, id, severity, trim(message, length), suppressed);
 }
 
-void GLDebug::enable() {
+void GLDebug::enable(bool synchronous) {
 	GLint flags;
 	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
 	if (flags & GL_CONTEXT_FLAG_DEBUG_BIT)
 	{
 		// initialize debug output
 		glEnable(GL_DEBUG_OUTPUT);
-		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		if (synchronous) {
+			glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		}
+		else {
+			glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		}
 		glDebugMessageCallback(GLDebug::debugOutputHandler, nullptr);
 		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
-		Log::info("Enabling debug mode for opengl");
+		Log::info("Enabling debug mode for opengl ({})", synchronous ? "synchronous" : "asynchronous");
 	} else {
 		Log::warn("Unable to enable debug mode for opengl");
 	}
 }
 
+void GLDebug::update() {
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		if (!newSinceSummary || Clock::now() - lastSummary < summaryInterval) {
+			return;
+		}
+	}
+	logSummary();
+}
+
+void GLDebug::logSummary() {
+	struct Row {
+		GLuint id;
+		MessageStats stats;
+	};
+	std::vector<Row> rows;
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		newSinceSummary = false;
+		lastSummary = Clock::now();
+		for (const auto& [id, entry] : stats) {
+			rows.push_back({ id, entry });
+		}
+	}
+	if (rows.empty()) return;
+
+	std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.stats.count > b.stats.count; });
+	fmt::memory_buffer table;
+	fmt::format_to(table, "[OPENGL] message summary\n{:>10}  {:>10}  {:<8}  {:<20}  {}", "count", "id", "severity", "type", "message");
+	for (const Row& row : rows) {
+		fmt::format_to(table, "\n{:>10}  {:>10}  {:<8}  {:<20}  {}",
+			row.stats.count, row.id, severityName(row.stats.severity), typeName(row.stats.type), row.stats.text);
+	}
+	Log::info("{}", fmt::string_view(table.data(), table.size()));
+}
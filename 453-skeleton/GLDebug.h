@@ -7,6 +7,12 @@
 //
 // We are going to use it (best we can) to give you advanced warning of when you
 // are doing something incorrectly.
+//
+// Messages are counted per message id. The first few of each id are logged in
+// full; after that an id is logged at most once per second, with the number of
+// repeats it swallowed, so a warning fired on every draw call can't flood the
+// console. update() logs a table of all counts every few seconds while new
+// messages keep arriving.
 //------------------------------------------------------------------------------
 
 
@@ -17,10 +23,17 @@ namespace GLDebug {
 		GLenum type,
 		GLuint id,
 		GLenum severity,
-		GLsizei,
+		GLsizei length,
 		const GLchar *message,
 		const void *
 	);
 
-	void enable();
+	// Synchronous output makes the driver report a message inside the offending
+	// call, which is what you want under a debugger. Asynchronous output lets the
+	// driver carry on and report later, possibly from another thread.
+	void enable(bool synchronous = true);
+
+	// Call once per frame; logs the summary table when it's due
+	void update();
+	void logSummary();
 }
@@ -0,0 +1,729 @@
+#include "Game.h"
+
+#include "Fixed.h"
+#include "Log.h"
+#include "SpriteKernels.h"
+#include "Trace.h"
+#include "Transforms.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+///////////////													//////////////////////////////
+///////////////				Movement Variables					//////////////////////////////
+///////////////													//////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////
+namespace {
+	// Per tick at Game::referenceTickRate
+	const float movingDistance = 1.0f / 2000.0f;
+	const float rotationDistance = PI / 1500.0f;
+
+	const float childSpacing = 0.15f;		// gap between diamonds in the ship's trail
+	const float shipGrowth = 1.1f;			// ship scale factor per pickup
+	const float maxShipScale = 32.f;		// several times the level's size already
+	const float pickupShrink = 0.5f;		// diamond scale factor when picked up
+
+	const glm::vec2 shipSize(0.15f, 0.10f);
+	const float diamondSize = 0.10f;
+	const glm::vec2 fireSize(0.3f, 0.4f);	// relative to its diamond
+	const float fireOrbitRadius = 2.f;		// relative to its diamond
+
+	// Per-entity loops are split into jobs of at most this many entities
+	const size_t entityChunk = 256;
+
+	// A worker still letting go of a job keeps the frame arena for a tick or
+	// two; this long means a job outlives its tick and the arena only grows
+	const uint32_t scratchHeldWarning = 16;
+
+	// Collision circles, per unit of the sprite's scale: the geometric mean of
+	// its half extents, so a long thin sprite isn't given its full length.
+	// The quads span -1 to 1, so a diamond's radius is its scale.
+	const float shipHitRadius = 0.1224745f;		// sqrt(shipSize.x * shipSize.y)
+	const float fireHitRadius = 0.3464102f;		// sqrt(fireSize.x * fireSize.y)
+	// Circles around the whole quads, for when alpha masks decide the hits
+	// and the circles only have to find the candidates
+	const float shipBoundRadius = 0.1802776f;	// length(shipSize)
+	const float diamondBoundRadius = 1.4142136f;	// sqrt(2)
+	const float fireBoundRadius = 0.5f;			// length(fireSize)
+
+	// Bounds in the broadphase tree are this much bigger than they need to be,
+	// for rounding and for the drift of unit vectors, so it never misses a hit
+	// the exact test would find
+	const float boundsSlack = 1.f / 1024.f;
+
+	// The slowest tick rate allowed: the ship moves a quarter of its hit
+	// radius a tick at 10 Hz
+	const uint32_t minTickRate = 10;
+
+
+	// The arithmetic the update steps are written in. The state always holds
+	// floats: load() turns one into a Scalar and store() turns it back.
+	//
+	// FloatMath is plain float arithmetic.
+	struct FloatMath {
+		using Scalar = float;
+
+		static constexpr Scalar half = 0.5f;
+		static constexpr Scalar threeHalves = 1.5f;
+
+		static Scalar constant(float value) { return value; }
+		static Scalar load(float value) { return value; }
+		static float store(Scalar value) { return value; }
+		static Scalar fromCount(uint32_t count) { return static_cast<float>(count); }
+		static Scalar mul(Scalar a, Scalar b) { return a * b; }
+		static Scalar atan2(Scalar y, Scalar x) { return FastAtan2(y, x); }
+		static bool turnsLeft(Scalar theta, Scalar angle) { return Goleft(theta, angle); }
+
+		static Fixed::Q toFixed(Scalar value) { return Fixed::fromFloat(value); }
+
+		// Whether (x, y) is within range of the segment from (fromX, fromY)
+		// along (dx, dy): the distance to its closest point, which is `along`
+		// of the way
+		static bool segmentHits(Scalar fromX, Scalar fromY, Scalar dx, Scalar dy, float x, float y, Scalar range, Scalar& along) {
+			Scalar lengthSquared = dx * dx + dy * dy;
+			along = lengthSquared > 0.f ? ((x - fromX) * dx + (y - fromY) * dy) / lengthSquared : 0.f;
+			along = std::min(std::max(along, 0.f), 1.f);
+			Scalar offsetX = x - (fromX + along * dx);
+			Scalar offsetY = y - (fromY + along * dy);
+			return offsetX * offsetX + offsetY * offsetY < range * range;
+		}
+	};
+
+	// FixedMath works in Q16.16 integers (see Fixed.h), and every float it
+	// stores is exactly a Q16.16 value, so it loses nothing going through the
+	// state and computes the same bits on every machine.
+	struct FixedMath {
+		using Scalar = Fixed::Q;
+
+		static constexpr Scalar half = Fixed::one / 2;
+		static constexpr Scalar threeHalves = Fixed::one * 3 / 2;
+
+		static Scalar constant(float value) { return Fixed::fromFloat(value); }
+		static Scalar load(float value) { return Fixed::load(value); }
+		static float store(Scalar value) { return Fixed::toFloat(value); }
+		static Scalar fromCount(uint32_t count) { return static_cast<Scalar>(count) << Fixed::fractionBits; }
+		static Scalar mul(Scalar a, Scalar b) { return Fixed::mul(a, b); }
+		static Scalar atan2(Scalar y, Scalar x) { return Fixed::atan2(y, x); }
+		static Fixed::Q toFixed(Scalar value) { return value; }
+
+		// Goleft() with angles in [0, 2PI) as Q16.16
+		static bool turnsLeft(Scalar theta, Scalar angle) {
+			Scalar distancePos = angle > theta ? angle - theta : angle + Fixed::twoPi - theta;
+			Scalar distanceNeg = angle > theta ? theta - (angle - Fixed::twoPi) : theta - angle;
+			return distancePos <= distanceNeg;
+		}
+
+		// The closest point comes from an exact integer projection, rounded
+		// once, and the squared distance is exact in 64 bits
+		static bool segmentHits(Scalar fromX, Scalar fromY, Scalar dx, Scalar dy, float x, float y, Scalar range, Scalar& along) {
+			int64_t lengthSquared = static_cast<int64_t>(dx) * dx + static_cast<int64_t>(dy) * dy;
+			along = 0;
+			if (lengthSquared > 0) {
+				int64_t projection = static_cast<int64_t>(Fixed::load(x) - fromX) * dx + static_cast<int64_t>(Fixed::load(y) - fromY) * dy;
+				along = static_cast<Scalar>(std::min(std::max(projection * Fixed::one / lengthSquared, int64_t(0)), int64_t(Fixed::one)));
+			}
+			int64_t offsetX = Fixed::load(x) - (fromX + Fixed::mul(along, dx));
+			int64_t offsetY = Fixed::load(y) - (fromY + Fixed::mul(along, dy));
+			return offsetX * offsetX + offsetY * offsetY < static_cast<int64_t>(range) * range;
+		}
+	};
+
+	// Turns the unit vector (x, y) counterclockwise by the angle with cosine c
+	// and sine s. One Newton step towards length 1 keeps rounding from
+	// shrinking or growing it over many turns.
+	template <typename Math>
+	void Turn(typename Math::Scalar& x, typename Math::Scalar& y, typename Math::Scalar c, typename Math::Scalar s) {
+		using Scalar = typename Math::Scalar;
+		Scalar turnedX = Math::mul(c, x) - Math::mul(s, y);
+		Scalar turnedY = Math::mul(s, x) + Math::mul(c, y);
+		Scalar correction = Math::threeHalves - Math::mul(Math::half, Math::mul(turnedX, turnedX) + Math::mul(turnedY, turnedY));
+		x = Math::mul(turnedX, correction);
+		y = Math::mul(turnedY, correction);
+	}
+
+	// Fills in the direction vectors of a level from its angles
+	void InitDirections(GameState& level) {
+		GameHeader& header = level.header();
+		header.ship.headingX = std::cos(header.ship.theta);
+		header.ship.headingY = std::sin(header.ship.theta);
+		header.orbitX = std::cos(header.fireOrbit);
+		header.orbitY = std::sin(header.fireOrbit);
+		for (uint32_t i = 0; i < level.getEntityCount(); i++) {
+			level.diamondDirX()[i] = std::cos(level.diamondAngle()[i]);
+			level.diamondDirY()[i] = std::sin(level.diamondAngle()[i]);
+		}
+	}
+
+	// Rounds every number in a level to the nearest Q16.16 value, and
+	// recomputes the direction vectors with integer trigonometry, so that a
+	// fixed-point game starts from the same bits everywhere
+	void SnapToFixedPoint(GameState& level) {
+		auto snap = [](float& value) { value = Fixed::toFloat(Fixed::fromFloat(value)); };
+		auto direction = [](float angle, float& x, float& y) {
+			Fixed::Q q = Fixed::load(angle);
+			x = Fixed::toFloat(Fixed::cos(q));
+			y = Fixed::toFloat(Fixed::sin(q));
+		};
+
+		GameHeader& header = level.header();
+		snap(header.fireOrbit);
+		snap(header.winSpin);
+		snap(header.ship.x);
+		snap(header.ship.y);
+		snap(header.ship.theta);
+		snap(header.ship.scale);
+		direction(header.ship.theta, header.ship.headingX, header.ship.headingY);
+		direction(header.fireOrbit, header.orbitX, header.orbitY);
+		for (uint32_t i = 0; i < level.getEntityCount(); i++) {
+			snap(level.diamondX()[i]);
+			snap(level.diamondY()[i]);
+			snap(level.diamondAngle()[i]);
+			snap(level.diamondScale()[i]);
+			direction(level.diamondAngle()[i], level.diamondDirX()[i], level.diamondDirY()[i]);
+		}
+	}
+
+	// splitmix64: tiny, and unlike the <random> distributions it gives the same
+	// numbers with every standard library
+	uint64_t NextRandom(uint64_t& state) {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// Uniform in [low, high), in integer arithmetic so that no compiler
+	// setting can change the level
+	Fixed::Q RandomFixed(uint64_t& state, Fixed::Q low, Fixed::Q high) {
+		int64_t unit = static_cast<int64_t>(NextRandom(state) >> 40);
+		return static_cast<Fixed::Q>(low + ((static_cast<int64_t>(high - low) * unit) >> 24));
+	}
+
+	// The sprites' quads as AlphaMask poses, the same as their *Transform()s
+	// but from the direction vectors, in Q16.16 so that every machine tests
+	// the same texels. Diamonds leave out the victory spin, when nothing
+	// can be hit any more.
+	AlphaMask::Pose ShipPose(const ShipState& ship, Fixed::Q x, Fixed::Q y) {
+		const Fixed::Q headingX = Fixed::fromFloat(ship.headingX);
+		const Fixed::Q headingY = Fixed::fromFloat(ship.headingY);
+		const Fixed::Q scale = Fixed::fromFloat(ship.scale);
+		const Fixed::Q width = Fixed::mul(Fixed::fromFloat(shipSize.x), scale);
+		const Fixed::Q height = Fixed::mul(Fixed::fromFloat(shipSize.y), scale);
+		return AlphaMask::Pose{
+			x, y,
+			Fixed::mul(headingY, width), Fixed::mul(-headingX, width),
+			Fixed::mul(headingX, height), Fixed::mul(headingY, height),
+		};
+	}
+
+	AlphaMask::Pose DiamondPose(const GameState& state, uint32_t i) {
+		const Fixed::Q dirX = Fixed::fromFloat(state.diamondDirX()[i]);
+		const Fixed::Q dirY = Fixed::fromFloat(state.diamondDirY()[i]);
+		const Fixed::Q scale = Fixed::fromFloat(state.diamondScale()[i]);
+		return AlphaMask::Pose{
+			Fixed::fromFloat(state.diamondX()[i]), Fixed::fromFloat(state.diamondY()[i]),
+			Fixed::mul(dirX, scale), Fixed::mul(dirY, scale),
+			Fixed::mul(-dirY, scale), Fixed::mul(dirX, scale),
+		};
+	}
+
+	// Turned by the diamond's angle plus the orbit, less a quarter turn
+	AlphaMask::Pose FirePose(const GameState& state, uint32_t i) {
+		const Fixed::Q dirX = Fixed::fromFloat(state.diamondDirX()[i]);
+		const Fixed::Q dirY = Fixed::fromFloat(state.diamondDirY()[i]);
+		const Fixed::Q orbitX = Fixed::fromFloat(state.header().orbitX);
+		const Fixed::Q orbitY = Fixed::fromFloat(state.header().orbitY);
+		const Fixed::Q upX = Fixed::mul(dirX, orbitX) - Fixed::mul(dirY, orbitY);
+		const Fixed::Q upY = Fixed::mul(dirX, orbitY) + Fixed::mul(dirY, orbitX);
+		const Fixed::Q scale = Fixed::fromFloat(state.diamondScale()[i]);
+		const Fixed::Q width = Fixed::mul(Fixed::fromFloat(fireSize.x), scale);
+		const Fixed::Q height = Fixed::mul(Fixed::fromFloat(fireSize.y), scale);
+		return AlphaMask::Pose{
+			Fixed::fromFloat(state.fireX()[i]), Fixed::fromFloat(state.fireY()[i]),
+			Fixed::mul(upY, width), Fixed::mul(-upX, width),
+			Fixed::mul(upX, height), Fixed::mul(upY, height),
+		};
+	}
+}
+
+
+Game::Game(const GameState& level, JobSystem& jobs, Arithmetic arithmetic, uint32_t ticksPerSecond)
+	: initial(level)
+	, state(level)
+	, jobs(jobs)
+	, arithmetic(arithmetic)
+	, ticksPerSecond(std::max(ticksPerSecond, minTickRate))
+	, hits((level.getEntityCount() + 63) / 64, 0)
+	, broadphase(level.getEntityCount())
+	, proxies(level.getEntityCount(), AabbTree::none)
+	, scratch(64 * 1024)
+{
+	// Exactly the tuned steps at the reference rate
+	const float stepScale = static_cast<float>(referenceTickRate) / static_cast<float>(this->ticksPerSecond);
+	moveStep = movingDistance * stepScale;
+	turnStep = rotationDistance * stepScale;
+
+	// Fire positions are derived, so make sure the snapshot has them
+	if (arithmetic == Arithmetic::FixedPoint) {
+		moveStep = Fixed::toFloat(Fixed::fromFloat(moveStep));
+		turnStep = Fixed::toFloat(Fixed::fromFloat(turnStep));
+		turnCos = Fixed::toFloat(Fixed::cos(Fixed::load(turnStep)));
+		turnSin = Fixed::toFloat(Fixed::sin(Fixed::load(turnStep)));
+		SnapToFixedPoint(state);
+		updateFires<FixedMath>();
+	}
+	else {
+		turnCos = std::cos(turnStep);
+		turnSin = std::sin(turnStep);
+		updateFires<FloatMath>();
+	}
+	initial = state;
+	syncBroadphase();
+}
+
+
+void Game::tick(const TickInput& input) {
+	TRACE_ZONE("Game::tick");
+	jobs.setFrameArena(&scratch);
+	if (arithmetic == Arithmetic::FixedPoint) {
+		update<FixedMath>(input);
+	}
+	else {
+		update<FloatMath>(input);
+	}
+	state.header().tick++;
+
+	// Every job has been waited for, but a worker may still be letting go of
+	// one; then the arena just carries on until the next tick
+	jobs.setFrameArena(nullptr);
+	if (scratch.reset()) {
+		scratchHeldTicks = 0;
+	}
+	else if (++scratchHeldTicks == scratchHeldWarning) {
+		LOG_WARN("ARENA the tick arena hasn't been free to reset for {} ticks ({} bytes in use); a job is outliving its tick",
+			scratchHeldTicks, scratch.getUsed());
+	}
+}
+
+
+void Game::reset() {
+	// The tick counter keeps running; everything else goes back to the start
+	uint64_t tick = state.header().tick;
+	state.restore(initial);
+	state.header().tick = tick;
+	syncBroadphase();
+}
+
+
+void Game::restore(const GameState& snapshot) {
+	state.restore(snapshot);
+	syncBroadphase();
+}
+
+
+void Game::setHitMasks(const AlphaMask* ship, const AlphaMask* diamond, const AlphaMask* fire) {
+	shipMask = ship;
+	diamondMask = diamond;
+	fireMask = fire;
+}
+
+
+template <typename Math>
+void Game::update(const TickInput& input) {
+	using Scalar = typename Math::Scalar;
+	const Scalar rotation = Math::load(turnStep);
+	const ShipState& ship = state.ship();
+	Scalar startX = Math::load(ship.x);
+	Scalar startY = Math::load(ship.y);
+	if (input.moveForward) {
+		move<Math>(Math::load(moveStep));
+	}
+	if (input.moveBack) {
+		move<Math>(-Math::load(moveStep));
+	}
+	if (input.turning) {
+		turn<Math>(input.target);
+	}
+	if (input.reset) {
+		reset();
+		startX = Math::load(ship.x);
+		startY = Math::load(ship.y);
+	}
+
+	//spinning the collected diamonds once the player has won
+	GameHeader& header = state.header();
+	if (isWon()) {
+		header.winSpin = Math::store(Math::load(header.winSpin) - rotation);
+	}
+
+	//orbiting the fires around their diamonds
+	header.fireOrbit = Math::store(Math::load(header.fireOrbit) - rotation);
+	Scalar orbitX = Math::load(header.orbitX);
+	Scalar orbitY = Math::load(header.orbitY);
+	Turn<Math>(orbitX, orbitY, Math::load(turnCos), -Math::load(turnSin));
+	header.orbitX = Math::store(orbitX);
+	header.orbitY = Math::store(orbitY);
+	updateFires<Math>();
+
+	//reset game if a fire hit the ship anywhere along its way this tick,
+	//while the fire's diamond was still in play
+	if (fireHitsShip<Math>(startX, startY)) {
+		reset();
+	}
+}
+
+
+template <typename Math>
+void Game::move(typename Math::Scalar distance) {
+	TRACE_ZONE("Game::move");
+	using Scalar = typename Math::Scalar;
+	ShipState& ship = state.ship();
+	const Scalar dx = Math::mul(distance, Math::load(ship.headingX));
+	const Scalar dy = Math::mul(distance, Math::load(ship.headingY));
+	const Scalar fromX = Math::load(ship.x);
+	const Scalar fromY = Math::load(ship.y);
+	const Scalar shipX = fromX + dx;
+	const Scalar shipY = fromY + dy;
+	ship.x = Math::store(shipX);
+	ship.y = Math::store(shipY);
+
+	uint32_t* slot = state.diamondSlot();
+	float* x = state.diamondX();
+	float* y = state.diamondY();
+
+	//moving the children along with the ship
+	// (branch-free so the loop vectorizes)
+	const Scalar one = Math::fromCount(1);
+	const Scalar zero = Math::fromCount(0);
+	jobs.wait(jobs.parallelFor(0, state.getEntityCount(), entityChunk, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Scalar carried = slot[i] ? one : zero;
+			x[i] = Math::store(Math::load(x[i]) + Math::mul(dx, carried));
+			y[i] = Math::store(Math::load(y[i]) + Math::mul(dy, carried));
+		}
+	}));
+
+	//Hitboxes for diamonds along the whole step, so a long one can't jump
+	//over them, and then picked up in order
+	sweepHits<Math>(Target::Diamonds, fromX, fromY, shipX, shipY);
+
+	SpriteKernels::forEachHit(hits.data(), state.getEntityCount(), [this](size_t i) {
+		pickUp<Math>(static_cast<uint32_t>(i));
+	});
+}
+
+
+template <typename Math>
+void Game::turn(glm::vec2 target) {
+	TRACE_ZONE("Game::turn");
+	using Scalar = typename Math::Scalar;
+	const Scalar twoPi = Math::constant(2 * PI);
+	const Scalar rotation = Math::load(turnStep);
+	ShipState& ship = state.ship();
+	Scalar theta = Math::load(ship.theta);
+	Scalar angle = Math::atan2(Math::constant(target.y) - Math::load(ship.y), Math::constant(target.x) - Math::load(ship.x));
+	if (angle < 0) {
+		angle += twoPi;
+	}
+
+	//if the turning distance is more than how much we rotate by then rotate else don't do anything
+	Scalar distance = theta > angle ? theta - angle : angle - theta;
+	if (std::min(distance, twoPi - distance) <= rotation) {
+		return;
+	}
+
+	bool left = Math::turnsLeft(theta, angle);
+	const Scalar step = left ? rotation : -rotation;
+	const Scalar cosine = Math::load(turnCos);
+	const Scalar sine = left ? Math::load(turnSin) : -Math::load(turnSin);
+	theta += step;
+	Scalar headingX = Math::load(ship.headingX);
+	Scalar headingY = Math::load(ship.headingY);
+	Turn<Math>(headingX, headingY, cosine, sine);
+	ship.headingX = Math::store(headingX);
+	ship.headingY = Math::store(headingY);
+
+	//rotate children around the ship
+	uint32_t* slot = state.diamondSlot();
+	float* x = state.diamondX();
+	float* y = state.diamondY();
+	float* diamondAngle = state.diamondAngle();
+	float* dirX = state.diamondDirX();
+	float* dirY = state.diamondDirY();
+	const Scalar shipX = Math::load(ship.x);
+	const Scalar shipY = Math::load(ship.y);
+	const Scalar backX = Math::mul(-headingX, Math::constant(childSpacing));
+	const Scalar backY = Math::mul(-headingY, Math::constant(childSpacing));
+	const Scalar noStep = Math::fromCount(0);
+	jobs.wait(jobs.parallelFor(0, state.getEntityCount(), entityChunk, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Scalar trail = Math::fromCount(slot[i]);
+			Scalar turnedX = Math::load(dirX[i]);
+			Scalar turnedY = Math::load(dirY[i]);
+			Turn<Math>(turnedX, turnedY, cosine, sine);
+			diamondAngle[i] = Math::store(Math::load(diamondAngle[i]) + (slot[i] ? step : noStep));
+			dirX[i] = slot[i] ? Math::store(turnedX) : dirX[i];
+			dirY[i] = slot[i] ? Math::store(turnedY) : dirY[i];
+			x[i] = slot[i] ? Math::store(shipX + Math::mul(backX, trail)) : x[i];
+			y[i] = slot[i] ? Math::store(shipY + Math::mul(backY, trail)) : y[i];
+		}
+	}));
+
+	//making sure angle stays between 0 and 2PI
+	if (theta >= twoPi) theta -= twoPi;
+	if (theta <= 0) theta += twoPi;
+	ship.theta = Math::store(theta);
+}
+
+
+template <typename Math>
+void Game::sweepHits(Target target,
+	typename Math::Scalar fromX, typename Math::Scalar fromY, typename Math::Scalar toX, typename Math::Scalar toY)
+{
+	TRACE_ZONE("Game::sweepHits");
+	using Scalar = typename Math::Scalar;
+	std::fill(hits.begin(), hits.end(), 0);
+
+	const bool fires = target == Target::Fires;
+	const float* x = fires ? state.fireX() : state.diamondX();
+	const float* y = fires ? state.fireY() : state.diamondY();
+	const AlphaMask* mask = fires ? fireMask : diamondMask;
+	const bool masked = shipMask && mask;
+	const float shipRadiusPerScale = masked ? shipBoundRadius : shipHitRadius;
+	const float radiusPerScale = fires
+		? (masked ? fireBoundRadius : fireHitRadius)
+		: (masked ? diamondBoundRadius : 1.f);
+
+	// Broadphase: the tree finds the entities whose reach overlaps the box
+	// around the ship's path
+	const ShipState& ship = state.ship();
+	const float shipReach = shipRadiusPerScale * ship.scale + boundsSlack;
+	const glm::vec2 from(Math::store(fromX), Math::store(fromY));
+	const glm::vec2 to(Math::store(toX), Math::store(toY));
+	const Aabb path{ glm::min(from, to) - glm::vec2(shipReach), glm::max(from, to) + glm::vec2(shipReach) };
+
+	// Narrow phase: the exact distance from each one's circle to the path,
+	// then the masks, with the ship where it comes closest
+	const Scalar dx = toX - fromX;
+	const Scalar dy = toY - fromY;
+	const Scalar shipRadius = Math::mul(Math::constant(shipRadiusPerScale), Math::load(ship.scale));
+	const Scalar radius = Math::constant(radiusPerScale);
+	const float* scale = state.diamondScale();
+	broadphase.query(path, [&](uint32_t i) {
+		Scalar range = shipRadius + Math::mul(radius, Math::load(scale[i]));
+		Scalar along;
+		if (!Math::segmentHits(fromX, fromY, dx, dy, x[i], y[i], range, along)) {
+			return;
+		}
+		if (masked) {
+			AlphaMask::Pose shipPose = ShipPose(ship, Math::toFixed(fromX + Math::mul(along, dx)), Math::toFixed(fromY + Math::mul(along, dy)));
+			AlphaMask::Pose pose = fires ? FirePose(state, i) : DiamondPose(state, i);
+			if (!AlphaMask::overlaps(*shipMask, shipPose, *mask, pose)) {
+				return;
+			}
+		}
+		hits[i / 64] |= uint64_t(1) << (i % 64);
+	});
+}
+
+
+Aabb Game::reach(uint32_t i) const {
+	// The fire's whole orbit, which covers the diamond as well; with its
+	// whole quad, so it's enough with or without masks
+	const float radius = state.diamondScale()[i] * (fireOrbitRadius + fireBoundRadius) + boundsSlack;
+	return Aabb::around(glm::vec2(state.diamondX()[i], state.diamondY()[i]), radius);
+}
+
+
+void Game::syncBroadphase() {
+	TRACE_ZONE("Game::syncBroadphase");
+	const uint32_t* slot = state.diamondSlot();
+	for (uint32_t i = 0; i < state.getEntityCount(); i++) {
+		if (slot[i] && proxies[i] != AabbTree::none) {
+			broadphase.remove(proxies[i]);
+			proxies[i] = AabbTree::none;
+		}
+		else if (!slot[i] && proxies[i] == AabbTree::none) {
+			proxies[i] = broadphase.insert(reach(i), i);
+		}
+		else if (!slot[i]) {
+			// Loose diamonds don't move, so this only catches a snapshot
+			// from some other game
+			Aabb bounds = reach(i);
+			broadphase.move(proxies[i], bounds, bounds);
+		}
+	}
+}
+
+
+template <typename Math>
+void Game::pickUp(uint32_t i) {
+	using Scalar = typename Math::Scalar;
+	ShipState& ship = state.ship();
+	state.header().score++;
+	ship.scale = Math::store(std::min(Math::mul(Math::load(ship.scale), Math::constant(shipGrowth)), Math::constant(maxShipScale)));
+	ship.childCount++;
+
+	const Scalar headingX = Math::load(ship.headingX);
+	const Scalar headingY = Math::load(ship.headingY);
+	const Scalar trail = Math::fromCount(ship.childCount);
+	const Scalar spacing = Math::constant(childSpacing);
+	state.diamondSlot()[i] = ship.childCount;
+	broadphase.remove(proxies[i]);
+	proxies[i] = AabbTree::none;
+	state.diamondAngle()[i] = -ship.theta;
+	state.diamondDirX()[i] = ship.headingX;
+	state.diamondDirY()[i] = -ship.headingY;
+	state.diamondScale()[i] = Math::store(Math::mul(Math::load(state.diamondScale()[i]), Math::constant(pickupShrink)));
+	state.diamondX()[i] = Math::store(Math::load(ship.x) - Math::mul(Math::mul(headingX, trail), spacing));
+	state.diamondY()[i] = Math::store(Math::load(ship.y) - Math::mul(Math::mul(headingY, trail), spacing));
+}
+
+
+template <typename Math>
+void Game::updateFires() {
+	TRACE_ZONE("Game::updateFires");
+	using Scalar = typename Math::Scalar;
+	// Each fire sits at its diamond's angle plus the orbit angle: the product
+	// of the two direction vectors as complex numbers
+	const Scalar orbitX = Math::load(state.header().orbitX);
+	const Scalar orbitY = Math::load(state.header().orbitY);
+	const Scalar orbitRadius = Math::constant(fireOrbitRadius);
+	const float* x = state.diamondX();
+	const float* y = state.diamondY();
+	const float* dirX = state.diamondDirX();
+	const float* dirY = state.diamondDirY();
+	const float* scale = state.diamondScale();
+	float* fireX = state.fireX();
+	float* fireY = state.fireY();
+	jobs.wait(jobs.parallelFor(0, state.getEntityCount(), entityChunk, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Scalar radius = Math::mul(orbitRadius, Math::load(scale[i]));
+			Scalar directionX = Math::load(dirX[i]);
+			Scalar directionY = Math::load(dirY[i]);
+			fireX[i] = Math::store(Math::load(x[i]) + Math::mul(radius, Math::mul(directionX, orbitX) - Math::mul(directionY, orbitY)));
+			fireY[i] = Math::store(Math::load(y[i]) + Math::mul(radius, Math::mul(directionX, orbitY) + Math::mul(directionY, orbitX)));
+		}
+	}));
+}
+
+
+template <typename Math>
+bool Game::fireHitsShip(typename Math::Scalar fromX, typename Math::Scalar fromY) {
+	TRACE_ZONE("Game::fireHitsShip");
+	// A fire moves well under its hit radius plus the ship's in a tick, even
+	// at minTickRate, so it can't jump the ship; it is tested where the tick
+	// leaves it
+	sweepHits<Math>(Target::Fires, fromX, fromY, Math::load(state.ship().x), Math::load(state.ship().y));
+	return std::any_of(hits.begin(), hits.end(), [](uint64_t word) { return word != 0; });
+}
+
+
+GameState Game::classicLevel() {
+	GameState level(3);
+	GameHeader& header = level.header();
+	header.fireOrbit = PI / 2;
+	header.ship.theta = PI / 2;
+	header.ship.scale = 1.f;
+
+	const glm::vec2 positions[3] = {
+		glm::vec2(cos(PI / 4), sin(PI / 4)),
+		glm::vec2(cos(3 * PI / 4), sin(3 * PI / 4)),
+		glm::vec2(0.f, -0.8f),
+	};
+	for (uint32_t i = 0; i < 3; i++) {
+		level.diamondX()[i] = positions[i].x;
+		level.diamondY()[i] = positions[i].y;
+		level.diamondScale()[i] = diamondSize;
+	}
+	InitDirections(level);
+	return level;
+}
+
+
+GameState Game::generatedLevel(uint32_t entityCount, uint64_t seed) {
+	GameState level(entityCount);
+	GameHeader& header = level.header();
+	header.fireOrbit = PI / 2;
+	header.ship.theta = PI / 2;
+	header.ship.scale = 1.f;
+
+	// Far enough from the origin that no fire's quad reaches the ship's.
+	// Positions are drawn as Q16.16 values, so the level is the same on
+	// every machine for either arithmetic.
+	const int64_t spawnClearance = Fixed::fromFloat((fireOrbitRadius + fireBoundRadius) * diamondSize + shipBoundRadius);
+	const Fixed::Q extent = Fixed::fromFloat(0.95f);
+	uint64_t random = seed;
+	for (uint32_t i = 0; i < entityCount; i++) {
+		int64_t x, y;
+		do {
+			x = RandomFixed(random, -extent, extent);
+			y = RandomFixed(random, -extent, extent);
+		} while (x * x + y * y < spawnClearance * spawnClearance);
+		level.diamondX()[i] = Fixed::toFloat(static_cast<Fixed::Q>(x));
+		level.diamondY()[i] = Fixed::toFloat(static_cast<Fixed::Q>(y));
+		level.diamondScale()[i] = diamondSize;
+	}
+	InitDirections(level);
+	return level;
+}
+
+
+Affine2D Game::shipTransform(const GameState& state) {
+	const ShipState& ship = state.ship();
+	// The texture points up, which is a heading of PI/2: a quarter turn
+	// clockwise from the heading
+	Affine2D transform;
+	transform.axisX = glm::vec2(ship.headingY, -ship.headingX) * shipSize.x * ship.scale;
+	transform.axisY = glm::vec2(ship.headingX, ship.headingY) * shipSize.y * ship.scale;
+	transform.translation = glm::vec2(ship.x, ship.y);
+	return transform;
+}
+
+
+Affine2D Game::diamondTransform(const GameState& state, uint32_t i) {
+	return Affine2D::trs(
+		glm::vec2(state.diamondX()[i], state.diamondY()[i]),
+		state.diamondAngle()[i] + state.header().winSpin,
+		glm::vec2(state.diamondScale()[i])
+	);
+}
+
+
+Affine2D Game::fireTransform(const GameState& state, uint32_t i) {
+	// Fires ride along with their diamond (but not its victory spin)
+	Affine2D diamond = Affine2D::trs(
+		glm::vec2(state.diamondX()[i], state.diamondY()[i]),
+		state.diamondAngle()[i],
+		glm::vec2(state.diamondScale()[i])
+	);
+	return diamond
+		* Affine2D::rotate(state.header().fireOrbit - PI / 2)
+		* Affine2D::translate(0.f, fireOrbitRadius)
+		* Affine2D::scale(fireSize.x, fireSize.y);
+}
+
+
+void Game::spriteTransforms(const GameState& state, Affine2D* diamonds, Affine2D* fires) {
+	TRACE_ZONE("Game::spriteTransforms");
+	SpriteKernels::Sprites sprites{
+		state.diamondX(), state.diamondY(), state.diamondAngle(), state.diamondScale(), state.getEntityCount()
+	};
+	SpriteKernels::compose(sprites, state.header().winSpin, glm::vec2(1.f), diamonds);
+
+	// Where a fire sits relative to its diamond, the same for every fire:
+	// turned a quarter less than the orbit, since the texture points up
+	Affine2D orbit;
+	orbit.axisX = glm::vec2(state.header().orbitY, -state.header().orbitX);
+	orbit.axisY = glm::vec2(state.header().orbitX, state.header().orbitY);
+	Affine2D fire = orbit
+		* Affine2D::translate(0.f, fireOrbitRadius)
+		* Affine2D::scale(fireSize.x, fireSize.y);
+	SpriteKernels::composeChildren(sprites, 0.f, glm::vec2(1.f), fire, fires);
+}
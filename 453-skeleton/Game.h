@@ -0,0 +1,128 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The game's simulation: moves the ship, collects diamonds into a trail behind
+// it, orbits the fires and restarts the level when a fire hits the ship.
+//
+// Game owns the live GameState and a snapshot of the level's starting state,
+// so a reset is one restore of that snapshot however large the level is. It
+// never touches OpenGL; the *Transform() helpers turn a state into matrices
+// for drawing, so the same code runs windowed and headless.
+//------------------------------------------------------------------------------
+
+#include "AabbTree.h"
+#include "Affine2D.h"
+#include "AlphaMask.h"
+#include "FrameArena.h"
+#include "GameState.h"
+#include "JobSystem.h"
+#include "TickInput.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+class Game {
+
+public:
+	// How the simulation does its arithmetic. Float only reproduces a
+	// recording on the same build; FixedPoint does everything in Q16.16
+	// integers (see Fixed.h), so it gives the same state, bit for bit, with
+	// any compiler, flags or CPU.
+	enum class Arithmetic {
+		Float,
+		FixedPoint,
+	};
+
+	// The tick rate the per-tick distances in Game.cpp are tuned for. Other
+	// rates scale them, so the ship covers the same ground per second.
+	static constexpr uint32_t referenceTickRate = 1000;
+
+	// A FixedPoint game first rounds the level to Q16.16
+	Game(const GameState& level, JobSystem& jobs, Arithmetic arithmetic = Arithmetic::Float, uint32_t ticksPerSecond = referenceTickRate);
+
+	// Public interface
+	void tick(const TickInput& input);
+	void reset();
+
+	const GameState& getState() const { return state; }
+	const GameState& getInitialState() const { return initial; }
+	void restore(const GameState& snapshot);
+	// With masks, a hit is drawn texels overlapping rather than circles
+	// touching (the circles still find the candidates). All three or none;
+	// they must outlive the game.
+	void setHitMasks(const AlphaMask* ship, const AlphaMask* diamond, const AlphaMask* fire);
+
+	Arithmetic getArithmetic() const { return arithmetic; }
+	uint32_t getTicksPerSecond() const { return ticksPerSecond; }
+	bool isWon() const { return state.header().score >= static_cast<int32_t>(state.getEntityCount()); }
+
+	// The original three-diamond level
+	static GameState classicLevel();
+	// `entityCount` diamonds scattered at random, the same for the same seed on
+	// every machine. Keeps a clear space around the ship's starting point.
+	static GameState generatedLevel(uint32_t entityCount, uint64_t seed);
+
+	// World transforms for drawing
+	static Affine2D shipTransform(const GameState& state);
+	static Affine2D diamondTransform(const GameState& state, uint32_t i);
+	static Affine2D fireTransform(const GameState& state, uint32_t i);
+	// Every diamond's and every fire's transform at once (getEntityCount() of
+	// each), with the SIMD kernels in SpriteKernels.h
+	static void spriteTransforms(const GameState& state, Affine2D* diamonds, Affine2D* fires);
+
+private:
+	GameState initial;
+	GameState state;
+	JobSystem& jobs;
+	Arithmetic arithmetic;
+	uint32_t ticksPerSecond;
+
+	// How far the ship moves and turns in one tick at this tick rate, and the
+	// turn as a rotation matrix, so that headings turn without any
+	// trigonometry. Exact Q16.16 values in a FixedPoint game.
+	float moveStep;
+	float turnStep;
+	float turnCos;
+	float turnSin;
+
+	// One hit bit per entity (see SpriteKernels::forEachHit), sized once so
+	// ticks don't allocate
+	std::vector<uint64_t> hits;
+	// A proxy for every diamond still in play, with its fire's whole orbit
+	// as its bounds, so neither needs updating until it's picked up. Sizes
+	// vary with the level and the ship grows, which a grid would handle
+	// badly.
+	AabbTree broadphase;
+	std::vector<int32_t> proxies;		// per entity; AabbTree::none once carried
+	const AlphaMask* shipMask = nullptr;
+	const AlphaMask* diamondMask = nullptr;
+	const AlphaMask* fireMask = nullptr;
+	// The jobs a tick spawns, thrown away together at the end of the tick
+	FrameArena scratch;
+	uint32_t scratchHeldTicks = 0;		// ticks in a row the arena couldn't reset
+
+	// The steps of a tick, written once for either arithmetic: Math is one of
+	// the policies in Game.cpp
+	template <typename Math> void update(const TickInput& input);
+	template <typename Math> void move(typename Math::Scalar distance);
+	template <typename Math> void turn(glm::vec2 target);
+	// Sets the hit bit of every entity in play whose diamond or fire the
+	// ship touches on its way from one point to the other this tick: its
+	// circle, or with masks its texels where the ship passes closest
+	enum class Target {
+		Diamonds,
+		Fires,
+	};
+	template <typename Math> void sweepHits(Target target,
+		typename Math::Scalar fromX, typename Math::Scalar fromY, typename Math::Scalar toX, typename Math::Scalar toY);
+	template <typename Math> void pickUp(uint32_t i);
+	template <typename Math> void updateFires();
+	template <typename Math> bool fireHitsShip(typename Math::Scalar fromX, typename Math::Scalar fromY);
+
+	// Where entity i's diamond and fire can be while it's in play
+	Aabb reach(uint32_t i) const;
+	// Gives every entity in play a proxy and takes carried ones' away
+	void syncBroadphase();
+};
@@ -0,0 +1,90 @@
+#include "GameState.h"
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+
+GameState::GameState(uint32_t entityCount) {
+	allocate(entityCount);
+	std::memset(block, 0, bytes);
+	header().entityCount = entityCount;
+}
+
+
+GameState::GameState(const GameState& other) {
+	allocate(other.entityCount);
+	std::memcpy(block, other.block, bytes);
+}
+
+
+GameState& GameState::operator=(const GameState& other) {
+	if (this == &other) return *this;
+	if (entityCount != other.entityCount) {
+		release();
+		allocate(other.entityCount);
+	}
+	std::memcpy(block, other.block, bytes);
+	return *this;
+}
+
+
+GameState::GameState(GameState&& other) noexcept
+	: block(std::exchange(other.block, nullptr))
+	, bytes(std::exchange(other.bytes, 0))
+	, stride(std::exchange(other.stride, 0))
+	, entityCount(std::exchange(other.entityCount, 0))
+{}
+
+
+GameState& GameState::operator=(GameState&& other) noexcept {
+	std::swap(block, other.block);
+	std::swap(bytes, other.bytes);
+	std::swap(stride, other.stride);
+	std::swap(entityCount, other.entityCount);
+	return *this;
+}
+
+
+GameState::~GameState() {
+	release();
+}
+
+
+uint64_t GameState::hash() const {
+	// Four independent multiply-xorshift chains over 8-byte words, so the
+	// multiplies overlap; the block is always a whole number of 32 bytes
+	const uint64_t multiplier = 0xff51afd7ed558ccdull;
+	uint64_t lanes[4] = { bytes, bytes + 1, bytes + 2, bytes + 3 };
+	for (size_t offset = 0; offset < bytes; offset += sizeof(lanes)) {
+		for (int lane = 0; lane < 4; lane++) {
+			uint64_t word;
+			std::memcpy(&word, block + offset + lane * sizeof(word), sizeof(word));
+			lanes[lane] = (lanes[lane] ^ word) * multiplier;
+			lanes[lane] ^= lanes[lane] >> 29;
+		}
+	}
+	uint64_t result = 0;
+	for (uint64_t lane : lanes) {
+		result = (result ^ lane) * multiplier;
+		result ^= result >> 32;
+	}
+	return result;
+}
+
+
+void GameState::allocate(uint32_t count) {
+	entityCount = count;
+	stride = (count * sizeof(float) + alignment - 1) / alignment * alignment;
+	bytes = headerBytes + ArrayCount * stride;
+	block = static_cast<std::byte*>(::operator new(bytes, std::align_val_t(alignment)));
+}
+
+
+void GameState::release() {
+	if (block) {
+		::operator delete(block, std::align_val_t(alignment));
+	}
+	block = nullptr;
+	bytes = 0;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// The complete simulation state of one game, in a single contiguous block.
+//
+// Nothing in the block points anywhere. Copying a state, taking a snapshot or
+// restoring one is a single memcpy, whatever the number of entities, and two
+// states can be compared or hashed as raw bytes.
+//
+// Per-entity data is stored as structure-of-arrays: one array per field, each
+// starting on a cache line, so per-entity loops stream through memory.
+//
+// Every diamond i has a fire i orbiting it. Diamond i is still in play while
+// diamondSlot()[i] == 0; once picked up it becomes the slot-th child trailing
+// behind the ship, and its fire can no longer hurt the player.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+
+struct ShipState {
+	float x;
+	float y;
+	float theta;		// heading in radians, kept in (0, 2PI]
+	float headingX;		// (cos theta, sin theta), turned along with theta so
+	float headingY;		// moving needs no trigonometry
+	float scale;		// grows with every pickup
+	uint32_t childCount;
+};
+
+struct GameHeader {
+	uint64_t tick;
+	int32_t score;
+	uint32_t entityCount;	// number of diamonds (and fires)
+	float fireOrbit;		// angle of every fire around its diamond
+	float orbitX;			// (cos fireOrbit, sin fireOrbit), turned along with it
+	float orbitY;
+	float winSpin;			// how far the diamonds have spun since the game was won
+	ShipState ship;
+};
+
+static_assert(std::is_trivially_copyable<GameHeader>::value, "GameHeader must stay plain data");
+
+
+class GameState {
+
+public:
+	explicit GameState(uint32_t entityCount = 0);
+
+	// The block is owned, so copies are deep (one memcpy) and moves steal it.
+	// https://en.cppreference.com/w/cpp/language/rule_of_three
+	GameState(const GameState& other);
+	GameState& operator=(const GameState& other);
+	GameState(GameState&& other) noexcept;
+	GameState& operator=(GameState&& other) noexcept;
+	~GameState();
+
+	// Public interface
+	// Same as assignment, spelled out for snapshots. Never allocates when
+	// both states have the same entity count.
+	void restore(const GameState& snapshot) { *this = snapshot; }
+
+	const void* data() const { return block; }
+	size_t size() const { return bytes; }
+	uint32_t getEntityCount() const { return entityCount; }
+
+	// 64 bits summing up every byte of the state, for spotting where two runs
+	// of the same game part ways. Not meant to resist deliberate collisions.
+	uint64_t hash() const;
+
+	GameHeader& header() { return *reinterpret_cast<GameHeader*>(block); }
+	const GameHeader& header() const { return *reinterpret_cast<const GameHeader*>(block); }
+	ShipState& ship() { return header().ship; }
+	const ShipState& ship() const { return header().ship; }
+
+	float* diamondX() { return array<float>(DiamondX); }
+	float* diamondY() { return array<float>(DiamondY); }
+	float* diamondAngle() { return array<float>(DiamondAngle); }
+	float* diamondDirX() { return array<float>(DiamondDirX); }
+	float* diamondDirY() { return array<float>(DiamondDirY); }
+	float* diamondScale() { return array<float>(DiamondScale); }
+	uint32_t* diamondSlot() { return array<uint32_t>(DiamondSlot); }
+	float* fireX() { return array<float>(FireX); }
+	float* fireY() { return array<float>(FireY); }
+
+	const float* diamondX() const { return array<float>(DiamondX); }
+	const float* diamondY() const { return array<float>(DiamondY); }
+	const float* diamondAngle() const { return array<float>(DiamondAngle); }
+	const float* diamondDirX() const { return array<float>(DiamondDirX); }
+	const float* diamondDirY() const { return array<float>(DiamondDirY); }
+	const float* diamondScale() const { return array<float>(DiamondScale); }
+	const uint32_t* diamondSlot() const { return array<uint32_t>(DiamondSlot); }
+	const float* fireX() const { return array<float>(FireX); }
+	const float* fireY() const { return array<float>(FireY); }
+
+private:
+	enum Array {
+		DiamondX,
+		DiamondY,
+		DiamondAngle,	// counterclockwise rotation carried over from the ship
+		DiamondDirX,	// (cos, sin) of DiamondAngle, turned along with it
+		DiamondDirY,
+		DiamondScale,
+		DiamondSlot,	// 0 while in play, otherwise position in the ship's trail
+		FireX,			// fire positions, derived every tick for hit tests
+		FireY,
+		ArrayCount
+	};
+
+	std::byte* block = nullptr;
+	size_t bytes = 0;
+	size_t stride = 0;		// bytes per array, padded to a cache line
+	uint32_t entityCount = 0;
+
+	template <typename T>
+	T* array(Array a) const {
+		return reinterpret_cast<T*>(block + headerBytes + a * stride);
+	}
+
+	static const size_t alignment = 64;
+	static const size_t headerBytes = (sizeof(GameHeader) + alignment - 1) / alignment * alignment;
+
+	void allocate(uint32_t count);
+	void release();
+};
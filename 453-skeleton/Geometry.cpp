@@ -1,20 +1,226 @@
 #include "Geometry.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <limits>
 #include <utility>
 
 
+namespace {
+	VertexLayout VertexFormat() {
+		VertexLayout layout(sizeof(Vertex));
+		layout.add(0, 3, GL_FLOAT, offsetof(Vertex, pos))
+			.add(1, 2, GL_FLOAT, offsetof(Vertex, texCoord));
+		return layout;
+	}
+}
+
+
 GPU_Geometry::GPU_Geometry()
 	: vao()
-	, vertBuffer(0, 3, GL_FLOAT)
-	, texCoordBuffer(1, 2, GL_FLOAT)
+	, vertexBuffer(VertexFormat())
+	, indexBuffer()
 {}
 
 
-void GPU_Geometry::setVerts(const std::vector<glm::vec3>& verts) {
-	vertBuffer.uploadData(sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
+GPU_Geometry::GPU_Geometry(const VertexLayout& instanceLayout)
+	: GPU_Geometry()
+{
+	instanceBuffer.emplace(instanceLayout);
+}
+
+
+void GPU_Geometry::upload(const CPU_Geometry& geometry) {
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices = geometry.indices;
+	if (indices.empty()) {
+		for (size_t i = 0; i < geometry.verts.size(); i++) {
+			Vertex vertex{ geometry.verts[i], geometry.texCoords[i] };
+			auto same = std::find_if(vertices.begin(), vertices.end(), [&](const Vertex& other) {
+				return other.pos == vertex.pos && other.texCoord == vertex.texCoord;
+			});
+			indices.push_back(static_cast<GLuint>(same - vertices.begin()));
+			if (same == vertices.end()) {
+				vertices.push_back(vertex);
+			}
+		}
+	}
+	else {
+		for (size_t i = 0; i < geometry.verts.size(); i++) {
+			vertices.push_back(Vertex{ geometry.verts[i], geometry.texCoords[i] });
+		}
+	}
+
+	vertexBuffer.uploadData(sizeof(Vertex) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
+	vao.bind();
+	indexBuffer.uploadData(sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW);
+	indexCount = static_cast<GLsizei>(indices.size());
+}
+
+
+void GPU_Geometry::setInstances(const void* data, GLsizeiptr size) {
+	instanceBuffer->uploadData(size, data, GL_STREAM_DRAW);
+}
+
+
+void GPU_Geometry::draw() const {
+	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0);
+}
+
+
+void GPU_Geometry::drawInstanced(GLsizei instances) const {
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)0, instances);
 }
 
 
-void GPU_Geometry::setTexCoords(const std::vector<glm::vec2>& texCoords) {
-	texCoordBuffer.uploadData(sizeof(glm::vec2) * texCoords.size(), texCoords.data(), GL_STATIC_DRAW);
+CPU_Geometry shipGeom() {
+	CPU_Geometry retGeom;
+	
+	retGeom.verts.push_back(glm::vec3(-1.f, 1.f, 0.f));
+	retGeom.verts.push_back(glm::vec3(-1.f, -1.f, 0.f));
+	retGeom.verts.push_back(glm::vec3(1.f, -1.f, 0.f));
+	retGeom.verts.push_back(glm::vec3(1.f, 1.f, 0.f));
+	
+
+	// texture coordinates
+	retGeom.texCoords.push_back(glm::vec2(0.f, 1.f));
+	retGeom.texCoords.push_back(glm::vec2(0.f, 0.f));
+	retGeom.texCoords.push_back(glm::vec2(1.f, 0.f));
+	retGeom.texCoords.push_back(glm::vec2(1.f, 1.f));
+
+	// two triangles sharing the diagonal
+	retGeom.indices = { 0, 1, 2, 0, 2, 3 };
+	return retGeom;
+}
+
+CPU_Geometry DiamondGeom() {
+	CPU_Geometry retGeom;
+	
+	retGeom.verts.push_back(glm::vec3(-1.f, 1.f, 0.f));
+	retGeom.verts.push_back(glm::vec3(-1.f, -1.f, 0.f));
+	retGeom.verts.push_back(glm::vec3(1.f, -1.f, 0.f));
+	retGeom.verts.push_back(glm::vec3(1.f, 1.f, 0.f));
+
+	// texture coordinates
+	retGeom.texCoords.push_back(glm::vec2(0.f, 1.f));
+	retGeom.texCoords.push_back(glm::vec2(0.f, 0.f));
+	retGeom.texCoords.push_back(glm::vec2(1.f, 0.f));
+	retGeom.texCoords.push_back(glm::vec2(1.f, 1.f));
+
+	// two triangles sharing the diagonal
+	retGeom.indices = { 0, 1, 2, 0, 2, 3 };
+	return retGeom;
+}
+
+
+namespace {
+	// Twice the signed area of the triangle o, a, b: positive if it turns left
+	float Cross(glm::vec2 o, glm::vec2 a, glm::vec2 b) {
+		return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+	}
+
+	// Andrew's monotone chain: counterclockwise, without collinear points
+	std::vector<glm::vec2> ConvexHull(std::vector<glm::vec2> points) {
+		std::sort(points.begin(), points.end(), [](glm::vec2 a, glm::vec2 b) {
+			return a.x < b.x || (a.x == b.x && a.y < b.y);
+		});
+		points.erase(std::unique(points.begin(), points.end()), points.end());
+		if (points.size() < 3) {
+			return points;
+		}
+		std::vector<glm::vec2> hull(2 * points.size());
+		size_t k = 0;
+		for (size_t i = 0; i < points.size(); i++) {
+			while (k >= 2 && Cross(hull[k - 2], hull[k - 1], points[i]) <= 0.f) k--;
+			hull[k++] = points[i];
+		}
+		for (size_t i = points.size() - 1, lower = k + 1; i-- > 0;) {
+			while (k >= lower && Cross(hull[k - 2], hull[k - 1], points[i]) <= 0.f) k--;
+			hull[k++] = points[i];
+		}
+		hull.resize(k - 1);
+		return hull;
+	}
+
+	// Cuts a counterclockwise convex polygon down to maxVertices by dropping
+	// edges: each time, the edge whose neighbours, extended until they meet,
+	// add the least area while staying inside [0, size]. The polygon only
+	// ever grows, so it still covers everything it did.
+	void DropEdges(std::vector<glm::vec2>& hull, size_t maxVertices, glm::vec2 size) {
+		while (hull.size() > maxVertices) {
+			const size_t n = hull.size();
+			size_t best = n;
+			float bestArea = std::numeric_limits<float>::max();
+			glm::vec2 bestCorner;
+			for (size_t i = 0; i < n; i++) {
+				// Edge b-c goes; a-b and d-c extended meet at the new corner
+				glm::vec2 a = hull[(i + n - 1) % n];
+				glm::vec2 b = hull[i];
+				glm::vec2 c = hull[(i + 1) % n];
+				glm::vec2 d = hull[(i + 2) % n];
+				glm::vec2 ab = b - a;
+				glm::vec2 dc = c - d;
+				float denominator = ab.x * dc.y - ab.y * dc.x;
+				if (denominator == 0.f) continue;
+				float t = ((d.x - a.x) * dc.y - (d.y - a.y) * dc.x) / denominator;
+				float u = ((d.x - a.x) * ab.y - (d.y - a.y) * ab.x) / denominator;
+				// They have to meet beyond the edge, not behind it
+				if (t < 1.f || u < 1.f) continue;
+				glm::vec2 corner = a + t * ab;
+				if (corner.x < 0.f || corner.y < 0.f || corner.x > size.x || corner.y > size.y) continue;
+				float area = Cross(b, corner, c);
+				if (area < bestArea) {
+					best = i;
+					bestArea = area;
+					bestCorner = corner;
+				}
+			}
+			if (best == n) {
+				return;
+			}
+			hull[best] = bestCorner;
+			hull.erase(hull.begin() + (best + 1) % n);
+		}
+	}
+}
+
+
+CPU_Geometry TrimmedQuad(const AlphaMask& mask, size_t maxVertices) {
+	std::vector<glm::vec2> hull;
+	glm::vec2 size(1.f);
+	if (!mask.empty()) {
+		// The outer corners of each row's first and last drawn texels, in
+		// texels. Linear filtering reaches half a texel further.
+		const AlphaMask::Level& texels = mask.level(0);
+		size = glm::vec2(texels.width, texels.height);
+		std::vector<glm::vec2> corners;
+		for (int y = 0; y < texels.height; y++) {
+			int first = 0;
+			while (first < texels.width && !texels.test(first, y)) first++;
+			if (first == texels.width) continue;
+			int last = texels.width - 1;
+			while (!texels.test(last, y)) last--;
+			for (float x : { first - 0.5f, last + 1.5f }) {
+				for (float cornerY : { y - 0.5f, y + 1.5f }) {
+					corners.push_back(glm::clamp(glm::vec2(x, cornerY), glm::vec2(0.f), size));
+				}
+			}
+		}
+		hull = ConvexHull(std::move(corners));
+		DropEdges(hull, std::max<size_t>(maxVertices, 3), size);
+	}
+	if (hull.size() < 3) {
+		hull = { glm::vec2(0.f), glm::vec2(size.x, 0.f), size, glm::vec2(0.f, size.y) };
+	}
+
+	CPU_Geometry geometry;
+	for (glm::vec2 corner : hull) {
+		glm::vec2 uv = corner / size;
+		geometry.verts.push_back(glm::vec3(2.f * uv - 1.f, 0.f));
+		geometry.texCoords.push_back(uv);
+	}
+	for (GLuint i = 1; i + 1 < hull.size(); i++) {
+		geometry.indices.insert(geometry.indices.end(), { 0, i, i + 1 });
+	}
+	return geometry;
 }
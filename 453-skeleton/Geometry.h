@@ -6,12 +6,17 @@
 // similar classes with the needed functionality
 //------------------------------------------------------------------------------
 
+#include "AlphaMask.h"
+#include "IndexBuffer.h"
+#include "RenderStats.h"
 #include "VertexArray.h"
 #include "VertexBuffer.h"
+#include "VertexLayout.h"
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <optional>
 #include <vector>
 
 
@@ -19,27 +24,65 @@
 struct CPU_Geometry {
 	std::vector<glm::vec3> verts;
 	std::vector<glm::vec2> texCoords;
+	std::vector<GLuint> indices;		// triangles; if empty, verts are taken three at a time
 	glm::mat3 transformationMatrix;
 };
 
+// Textured quads (-1 to 1) for the game's sprites; their size comes from
+// each object's transform
+CPU_Geometry shipGeom();
+CPU_Geometry DiamondGeom();
 
-// VAO and two VBOs for storing vertices and texture coordinates, respectively
+// The same quad (-1 to 1, UVs 0 to 1) cut down to a convex polygon of at most
+// maxVertices around the texels the mask has set, as an indexed triangle fan,
+// so the transparent texels around a sprite aren't rasterized only to be
+// discarded. It covers every fragment that could sample a drawn texel, even
+// with GL_LINEAR. An empty mask gives the whole quad.
+CPU_Geometry TrimmedQuad(const AlphaMask& mask, size_t maxVertices = 8);
+
+
+// One vertex as GPU_Geometry stores it: position (attribute 0) and texture
+// coordinates (attribute 1) side by side, so a vertex is one fetch
+struct Vertex {
+	glm::vec3 pos;
+	glm::vec2 texCoord;
+};
+
+
+// VAO with one interleaved VBO of Vertex, an index buffer, and optionally a
+// VBO of per-instance data
 class GPU_Geometry {
 
 public:
 	GPU_Geometry();
+	// With per-instance data laid out as `instanceLayout` (divisor 1, at
+	// locations after the vertex's), for drawInstanced()
+	explicit GPU_Geometry(const VertexLayout& instanceLayout);
 
 	// Public interface
-	void bind() { vao.bind(); }
+	void bind() { vao.bind(); RenderStats::countStateChange(); }
+
+	// Interleaves the vertices. Geometry without indices is indexed here,
+	// each distinct vertex stored once.
+	void upload(const CPU_Geometry& geometry);
+	// Replaces the per-instance data, which may change every frame. Only
+	// for geometry constructed with an instance layout.
+	void setInstances(const void* data, GLsizeiptr size);
 
-	void setVerts(const std::vector<glm::vec3>& verts);
-	void setTexCoords(const std::vector<glm::vec2>& texCoords);
+	// Issue the draw call for the whole geometry; bind() it first. Draw code
+	// counts it (see RenderStats).
+	void draw() const;
+	void drawInstanced(GLsizei instances) const;
+	GLsizei triangleCount() const { return indexCount / 3; }
 
 private:
 	// note: due to how OpenGL works, vao needs to be 
 	// defined and initialized before the vertex buffers
 	VertexArray vao;
 
-	VertexBuffer vertBuffer;
-	VertexBuffer texCoordBuffer;
+	VertexBuffer vertexBuffer;
+	IndexBuffer indexBuffer;
+	std::optional<VertexBuffer> instanceBuffer;
+
+	GLsizei indexCount = 0;
 };
@@ -0,0 +1,47 @@
+#include "GpuTimer.h"
+
+
+GpuTimer::GpuTimer() {
+	glGenQueries(depth, queries);
+}
+
+
+GpuTimer::~GpuTimer() {
+	glDeleteQueries(depth, queries);
+}
+
+
+void GpuTimer::begin() {
+	// Every query is still waiting on the GPU; skip this frame rather than stall
+	if (issued - collected == depth) {
+		return;
+	}
+	glBeginQuery(GL_TIME_ELAPSED, queries[issued % depth]);
+	active = true;
+}
+
+
+void GpuTimer::end() {
+	if (!active) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	issued++;
+	active = false;
+}
+
+
+bool GpuTimer::poll(double& ms) {
+	bool any = false;
+	while (collected < issued) {
+		GLuint query = queries[collected % depth];
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		ms = nanoseconds * 1e-6;
+		collected++;
+		any = true;
+	}
+	return any;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Measures how long the GPU spends on a stretch of commands, using
+// GL_TIME_ELAPSED queries.
+//
+// Results arrive a few frames late. The timer keeps a small ring of queries
+// and only ever reads ones the driver reports as finished, so it never makes
+// the CPU wait for the GPU. If every query is still in flight, that frame
+// simply isn't measured.
+//
+// Example:
+//   timer.begin();
+//   ...draw...
+//   timer.end();
+//   double ms;
+//   if (timer.poll(ms)) { ... }
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+
+class GpuTimer {
+
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// Public interface
+	void begin();
+	void end();
+
+	// Collects finished queries; true if there was one, with the latest in `ms`
+	bool poll(double& ms);
+
+private:
+	static const int depth = 4;
+
+	GLuint queries[depth];
+	uint64_t issued = 0;
+	uint64_t collected = 0;
+	bool active = false;
+};
@@ -0,0 +1,12 @@
+#include "IndexBuffer.h"
+
+
+IndexBuffer::IndexBuffer()
+	: bufferID{}
+{}
+
+
+void IndexBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
+	bind();
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, usage);
+}
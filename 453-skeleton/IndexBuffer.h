@@ -0,0 +1,23 @@
+#pragma once
+
+#include "GLHandles.h"
+
+#include <GL/glew.h>
+
+
+// An element array buffer of GLuint indices. The binding is part of the
+// vertex array's state, so bind the vertex array before uploading.
+class IndexBuffer {
+
+public:
+	IndexBuffer();
+
+	// Rule of zero, as with VertexBuffer
+
+	// Public interface
+	void bind() const { glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferID); }
+	void uploadData(GLsizeiptr size, const void* data, GLenum usage);
+
+private:
+	VertexBufferHandle bufferID;
+};
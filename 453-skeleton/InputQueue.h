@@ -0,0 +1,41 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A bounded, lock-free queue of timestamped input events.
+//
+// GLFW callbacks push events as they arrive (producer) and the simulation
+// drains them at tick boundaries (consumer), so a lock-free SpscRing is enough.
+//
+// Example:
+//   InputQueue queue;
+//   queue.push({ glfwGetTime(), InputEventType::Key, GLFW_KEY_W, GLFW_PRESS });
+//   while (const InputEvent* e = queue.front()) {
+//       if (e->time > tickEnd) break;   // belongs to a later tick
+//       apply(*e);
+//       queue.pop();
+//   }
+//------------------------------------------------------------------------------
+
+#include "SpscRing.h"
+
+#include <cstdint>
+
+
+enum class InputEventType : uint8_t {
+	Key,
+	MouseButton,
+	CursorPos,
+};
+
+// One raw input event. For CursorPos, x and y are already in OpenGL
+// coordinates ([-1, 1] on both axes).
+struct InputEvent {
+	double time = 0.0;		// glfwGetTime() when the event arrived
+	InputEventType type = InputEventType::Key;
+	int code = 0;			// GLFW key or mouse button
+	int action = 0;			// GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+	float x = 0.f;
+	float y = 0.f;
+};
+
+using InputQueue = SpscRing<InputEvent, 1024>;
@@ -0,0 +1,217 @@
+#include "InputRecording.h"
+
+#include "Log.h"
+
+#include <cstring>
+#include <stdexcept>
+
+
+namespace {
+	const char magic[4] = { 'S', 'S', 'I', 'R' };
+	const uint32_t version = 3;		// only this one is read; older layouts never shipped
+
+	enum HeaderOptions : uint32_t {
+		FixedPoint = 1 << 0,
+	};
+
+	enum RecordFlags : uint8_t {
+		MoveForward = 1 << 0,
+		MoveBack = 1 << 1,
+		Turning = 1 << 2,
+		Reset = 1 << 3,
+		HasTarget = 1 << 4,
+		HasHash = 1 << 5,
+		End = 1 << 7,
+	};
+
+	// Plain little-endian dumps; recordings are meant to be replayed on the
+	// same kind of machine that made them
+	template <typename T>
+	void writeRaw(std::ofstream& file, const T& value) {
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool readRaw(std::ifstream& file, T& value) {
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	void writeVarint(std::ofstream& file, uint64_t value) {
+		while (value >= 0x80) {
+			file.put(static_cast<char>((value & 0x7f) | 0x80));
+			value >>= 7;
+		}
+		file.put(static_cast<char>(value));
+	}
+
+	bool readVarint(std::ifstream& file, uint64_t& value) {
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			int byte = file.get();
+			if (byte == EOF) return false;
+			value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if (!(byte & 0x80)) return true;
+		}
+		return false;
+	}
+
+	bool sameButtons(const TickInput& a, const TickInput& b) {
+		return a.moveForward == b.moveForward && a.moveBack == b.moveBack
+			&& a.turning == b.turning && a.reset == b.reset;
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// InputRecorder
+//------------------------------------------------------------------------------
+
+InputRecorder::InputRecorder(const std::string& path, uint32_t ticksPerSecond, uint64_t seed, uint32_t entityCount, bool fixedPoint)
+	: file(path, std::ios::binary | std::ios::trunc)
+	, fixedPoint(fixedPoint)
+{
+	if (!file) {
+		throw std::runtime_error("Failed to open input recording for writing: " + path);
+	}
+	file.write(magic, sizeof(magic));
+	writeRaw(file, version);
+	writeRaw(file, ticksPerSecond);
+	writeRaw(file, seed);
+	writeRaw(file, entityCount);
+	writeRaw(file, static_cast<uint32_t>(fixedPoint ? FixedPoint : 0));
+}
+
+
+InputRecorder::~InputRecorder() {
+	finish();
+}
+
+
+void InputRecorder::record(const TickInput& input) {
+	bool targetChanged = tickCount == 0 || input.target != previous.target;
+	if (fixedPoint || tickCount == 0 || targetChanged || !sameButtons(input, previous)) {
+		uint8_t flags = (input.moveForward ? MoveForward : 0)
+			| (input.moveBack ? MoveBack : 0)
+			| (input.turning ? Turning : 0)
+			| (input.reset ? Reset : 0)
+			| (fixedPoint ? HasHash : 0);
+		writeRecord(flags, input, targetChanged);
+		previous = input;
+	}
+	tickCount++;
+}
+
+
+void InputRecorder::recordHash(uint64_t stateHash) {
+	// Ends the record that record() just wrote for this tick
+	if (fixedPoint) {
+		writeRaw(file, stateHash);
+	}
+}
+
+
+void InputRecorder::finish() {
+	if (finished) return;
+	writeRecord(End, previous, false);
+	file.flush();
+	finished = true;
+	Log::info("INPUT recorded {} ticks", tickCount);
+}
+
+
+void InputRecorder::writeRecord(uint8_t flags, const TickInput& input, bool targetChanged) {
+	writeVarint(file, tickCount - lastRecordTick);
+	lastRecordTick = tickCount;
+	file.put(static_cast<char>(flags | (targetChanged ? HasTarget : 0)));
+	if (targetChanged) {
+		writeRaw(file, input.target.x);
+		writeRaw(file, input.target.y);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// InputReplay
+//------------------------------------------------------------------------------
+
+InputReplay::InputReplay(const std::string& path)
+	: file(path, std::ios::binary)
+{
+	char fileMagic[4];
+	uint32_t fileVersion = 0;
+	if (!file || !file.read(fileMagic, sizeof(fileMagic)) || std::memcmp(fileMagic, magic, sizeof(magic)) != 0) {
+		throw std::runtime_error("Not an input recording: " + path);
+	}
+	if (!readRaw(file, fileVersion) || fileVersion != version) {
+		throw std::runtime_error("Unsupported input recording version: " + path);
+	}
+	uint32_t options = 0;
+	if (!readRaw(file, ticksPerSecond) || !readRaw(file, seed) || !readRaw(file, entityCount) || !readRaw(file, options)) {
+		throw std::runtime_error("Truncated input recording: " + path);
+	}
+	fixedPoint = options & FixedPoint;
+	readRecordHeader();
+}
+
+
+bool InputReplay::next(TickInput& input) {
+	while (!ended && tick == nextRecordTick) {
+		if (pendingFlags & End) {
+			ended = true;
+			break;
+		}
+		if (!readRecordBody()) {
+			ended = true;
+			break;
+		}
+		readRecordHeader();
+	}
+	if (ended) return false;
+
+	input = current;
+	tick++;
+	return true;
+}
+
+
+bool InputReplay::check(uint64_t stateHash) const {
+	return hashTick + 1 != tick || hash == stateHash;
+}
+
+
+bool InputReplay::readRecordHeader() {
+	uint64_t delta;
+	char flags;
+	if (!readVarint(file, delta) || !file.get(flags)) {
+		// A recording cut short (e.g. the game crashed) still replays up to that point
+		Log::warn("INPUT recording ends without an end marker after {} ticks", tick);
+		pendingFlags = End;
+		nextRecordTick = tick;
+		return false;
+	}
+	pendingFlags = static_cast<uint8_t>(flags);
+	nextRecordTick += delta;
+	return true;
+}
+
+
+bool InputReplay::readRecordBody() {
+	current.moveForward = pendingFlags & MoveForward;
+	current.moveBack = pendingFlags & MoveBack;
+	current.turning = pendingFlags & Turning;
+	current.reset = pendingFlags & Reset;
+	if (pendingFlags & HasTarget) {
+		if (!readRaw(file, current.target.x) || !readRaw(file, current.target.y)) {
+			Log::warn("INPUT recording is truncated after {} ticks", tick);
+			return false;
+		}
+	}
+	if (pendingFlags & HasHash) {
+		if (!readRaw(file, hash)) {
+			Log::warn("INPUT recording is truncated after {} ticks", tick);
+			return false;
+		}
+		hashTick = tick;
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Recording and replaying the per-tick input stream.
+//
+// A recording is a small header (magic, version, tick rate, level seed, entity
+// count, 0 meaning the classic level, and whether the game ran in fixed
+// point) followed by one record per tick on which the input changed:
+//
+//   varint   ticks since the previous record
+//   uint8    flags: buttons, "target follows", "hash follows", or "end of recording"
+//   float x2 new turn target (only if the target changed)
+//   uint64   GameState::hash() after the tick (only if flagged)
+//
+// Holding a key for ten seconds therefore costs two records, not ten thousand.
+// Replaying a recording on the same build reproduces the session exactly,
+// which makes it a fixed workload for comparing performance between builds.
+//
+// A fixed-point game (see Game::Arithmetic) reproduces on any build, so its
+// recordings also check that: every tick gets a record carrying the state's
+// hash, and the replay compares its own against it.
+//------------------------------------------------------------------------------
+
+#include "TickInput.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+
+class InputRecorder {
+
+public:
+	InputRecorder(const std::string& path, uint32_t ticksPerSecond, uint64_t seed, uint32_t entityCount, bool fixedPoint = false);
+	~InputRecorder();
+
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder operator=(const InputRecorder&) = delete;
+
+	// Public interface
+	void record(const TickInput& input);
+	// The state after the tick just recorded; only wanted if recordsHashes()
+	void recordHash(uint64_t stateHash);
+	void finish();
+
+	uint64_t getTickCount() const { return tickCount; }
+	bool recordsHashes() const { return fixedPoint; }
+
+private:
+	std::ofstream file;
+	TickInput previous;
+	uint64_t tickCount = 0;
+	uint64_t lastRecordTick = 0;
+	bool fixedPoint = false;
+	bool finished = false;
+
+	void writeRecord(uint8_t flags, const TickInput& input, bool targetChanged);
+};
+
+
+class InputReplay {
+
+public:
+	explicit InputReplay(const std::string& path);
+
+	// Public interface
+	// Fills in the input for the next tick. Returns false once the recording is over.
+	bool next(TickInput& input);
+	// False if the recording has a hash for the tick next() just returned,
+	// and it isn't `stateHash`
+	bool check(uint64_t stateHash) const;
+
+	uint32_t getTicksPerSecond() const { return ticksPerSecond; }
+	uint64_t getSeed() const { return seed; }
+	uint32_t getEntityCount() const { return entityCount; }
+	bool isFixedPoint() const { return fixedPoint; }
+	uint64_t getTick() const { return tick; }
+
+private:
+	std::ifstream file;
+	uint32_t ticksPerSecond = 0;
+	uint64_t seed = 0;
+	uint32_t entityCount = 0;
+	bool fixedPoint = false;
+
+	uint64_t hash = 0;
+	uint64_t hashTick = UINT64_MAX;		// the tick `hash` belongs to
+
+	TickInput current;
+	uint64_t tick = 0;
+	uint64_t nextRecordTick = 0;
+	uint8_t pendingFlags = 0;
+	bool ended = false;
+
+	bool readRecordHeader();
+	bool readRecordBody();
+};
@@ -0,0 +1,318 @@
+#include "JobSystem.h"
+
+#include "FrameArena.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <string>
+
+
+// A unit of work. `unfinished` counts the job itself plus any children it
+// spawned (parallelFor chunks); the job is done when it reaches zero.
+// `pendingDependencies` counts jobs that must finish before this one may run.
+//
+// A parallelFor group owns its body and splits [begin, end) into chunk jobs
+// that share it; a chunk runs the body over its own [begin, end).
+struct Job : std::enable_shared_from_this<Job> {
+	explicit Job(FrameArena* arena) : arena(arena) {}
+	~Job();
+
+	Job(const Job&) = delete;
+	Job operator=(const Job&) = delete;
+
+	std::function<void()> fn;	// run() jobs
+	RangeBody body;				// parallelFor jobs
+	size_t begin = 0;
+	size_t end = 0;
+	size_t grain = 0;
+	bool isGroup = false;
+	FrameArena* arena;			// where this job (and a group's body) came from
+
+	JobHandle parent;
+
+	std::atomic<int> unfinished{ 1 };
+	std::atomic<int> pendingDependencies{ 0 };
+	std::atomic<bool> done{ false };
+
+	std::mutex mutex; // guards dependents against concurrent completion
+	std::vector<JobHandle> dependents;
+};
+
+
+Job::~Job() {
+	if (isGroup && body.object) {
+		body.destroy(body.object);
+		if (arena) {
+			arena->release();
+		}
+		else {
+			::operator delete(body.object);
+		}
+	}
+}
+
+
+namespace {
+	// Which system (if any) the current thread works for, and its queue index
+	thread_local const JobSystem* tlsSystem = nullptr;
+	thread_local size_t tlsQueue = 0;
+}
+
+
+JobSystem::JobSystem(unsigned threadCount)
+	: running(true)
+	, queued(0)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (unsigned i = 0; i < threadCount; i++) {
+		queues.push_back(std::make_unique<WorkQueue>());
+	}
+	for (unsigned i = 1; i < threadCount; i++) {
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+
+JobHandle JobSystem::run(std::function<void()> fn, const std::vector<JobHandle>& dependencies) {
+	JobHandle job = makeJob();
+	job->fn = std::move(fn);
+	schedule(job, dependencies);
+	return job;
+}
+
+
+void* JobSystem::allocateBody(size_t size) {
+	return arena ? arena->allocate(size) : ::operator new(size);
+}
+
+
+JobHandle JobSystem::spawnParallelFor(
+	size_t begin, size_t end, size_t grain,
+	const RangeBody& body, const std::vector<JobHandle>& dependencies
+) {
+	// The group job only fans out into chunk jobs once its dependencies are met
+	JobHandle group = makeJob();
+	group->body = body;
+	group->begin = begin;
+	group->end = end;
+	group->grain = std::max<size_t>(grain, 1);
+	group->isGroup = true;
+	schedule(group, dependencies);
+	return group;
+}
+
+
+void JobSystem::runRange(Job* job) {
+	const RangeBody& body = job->body;
+	if (!job->isGroup) {
+		body.invoke(body.object, job->begin, job->end);
+		return;
+	}
+
+	// Small ranges never leave the thread that picked the group up
+	size_t begin = job->begin;
+	size_t end = job->end;
+	size_t grain = job->grain;
+	if (end <= begin) return;
+	size_t chunks = (end - begin + grain - 1) / grain;
+	if (chunks == 1) {
+		body.invoke(body.object, begin, end);
+		return;
+	}
+
+	job->unfinished.fetch_add(static_cast<int>(chunks - 1), std::memory_order_relaxed);
+	for (size_t c = 1; c < chunks; c++) {
+		JobHandle chunk = makeJob();
+		chunk->body = body;
+		chunk->begin = begin + c * grain;
+		chunk->end = std::min(end, chunk->begin + grain);
+		chunk->parent = job->shared_from_this();
+		submit(chunk);
+	}
+	// Run the first chunk here while the others get stolen
+	body.invoke(body.object, begin, std::min(end, begin + grain));
+}
+
+
+void JobSystem::wait(const JobHandle& job) {
+	if (!job) return;
+	size_t self = currentQueue();
+	while (!job->done.load(std::memory_order_acquire)) {
+		if (JobHandle work = next(self)) {
+			execute(work);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+}
+
+
+bool JobSystem::isDone(const JobHandle& job) {
+	return !job || job->done.load(std::memory_order_acquire);
+}
+
+
+JobHandle JobSystem::makeJob() {
+	return std::allocate_shared<Job>(ArenaAllocator<Job>(arena), arena);
+}
+
+
+void JobSystem::schedule(const JobHandle& job, const std::vector<JobHandle>& dependencies) {
+	// Hold one extra count so the job can't be released while we're still
+	// registering it with its dependencies
+	job->pendingDependencies.store(1, std::memory_order_relaxed);
+	for (const JobHandle& dependency : dependencies) {
+		if (!dependency) continue;
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (!dependency->done.load(std::memory_order_acquire)) {
+			job->pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+			dependency->dependents.push_back(job);
+		}
+	}
+	if (job->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		submit(job);
+	}
+}
+
+
+void JobSystem::submit(const JobHandle& job) {
+	WorkQueue& queue = *queues[currentQueue()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.pushBack(job);
+	}
+	queued.fetch_add(1, std::memory_order_release);
+
+	// Taking the sleep mutex orders this wakeup after any worker's predicate check
+	{ std::lock_guard<std::mutex> lock(sleepMutex); }
+	wake.notify_one();
+}
+
+
+void JobSystem::execute(const JobHandle& job) {
+	if (job->fn) {
+		TRACE_ZONE("job");
+		job->fn();
+	}
+	else if (job->body.invoke) {
+		TRACE_ZONE("job");
+		runRange(job.get());
+	}
+	if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		complete(job.get());
+	}
+}
+
+
+void JobSystem::complete(Job* job) {
+	std::vector<JobHandle> released;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->done.store(true, std::memory_order_release);
+		released.swap(job->dependents);
+	}
+	for (const JobHandle& dependent : released) {
+		if (dependent->pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			submit(dependent);
+		}
+	}
+
+	// A finished chunk counts down its parallelFor group
+	JobHandle parent = std::move(job->parent);
+	if (parent && parent->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		complete(parent.get());
+	}
+}
+
+
+size_t JobSystem::currentQueue() const {
+	return tlsSystem == this ? tlsQueue : 0;
+}
+
+
+JobHandle JobSystem::next(size_t self) {
+	// Newest job from our own deque first
+	{
+		WorkQueue& own = *queues[self];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.empty()) {
+			queued.fetch_sub(1, std::memory_order_relaxed);
+			return own.popBack();
+		}
+	}
+
+	// Otherwise steal the oldest job from someone else
+	for (size_t i = 1; i < queues.size(); i++) {
+		WorkQueue& victim = *queues[(self + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.empty()) {
+			queued.fetch_sub(1, std::memory_order_relaxed);
+			return victim.popFront();
+		}
+	}
+	return nullptr;
+}
+
+
+void JobSystem::workerLoop(size_t index) {
+	tlsSystem = this;
+	tlsQueue = index;
+	Trace::setThreadName("worker " + std::to_string(index));
+
+	while (running.load(std::memory_order_acquire)) {
+		if (JobHandle job = next(index)) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wake.wait(lock, [this]() {
+			return !running.load(std::memory_order_acquire) || queued.load(std::memory_order_acquire) > 0;
+		});
+	}
+}
+
+
+void JobSystem::WorkQueue::pushBack(JobHandle job) {
+	if (count == slots.size()) {
+		// Unroll into a ring twice the size
+		std::vector<JobHandle> grown(slots.size() * 2);
+		for (size_t i = 0; i < count; i++) {
+			grown[i] = std::move(slots[(head + i) % slots.size()]);
+		}
+		slots.swap(grown);
+		head = 0;
+	}
+	slots[(head + count) % slots.size()] = std::move(job);
+	count++;
+}
+
+
+JobHandle JobSystem::WorkQueue::popBack() {
+	count--;
+	return std::move(slots[(head + count) % slots.size()]);
+}
+
+
+JobHandle JobSystem::WorkQueue::popFront() {
+	JobHandle job = std::move(slots[head]);
+	head = (head + 1) % slots.size();
+	count--;
+	return job;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A small work-stealing job system.
+//
+// Every thread that runs jobs owns a deque. A thread pushes and pops jobs at
+// the back of its own deque, so freshly spawned (cache-warm) work runs first,
+// and steals from the front of another thread's deque when its own runs dry.
+//
+// Work is usually expressed with parallelFor(), which splits an index range
+// into chunks of at most `grain` indices. Every call returns a JobHandle that
+// can be waited on or passed as a dependency of later jobs, so the update
+// phases of a frame form a small graph instead of a fixed sequence.
+//
+// Example:
+//   JobSystem jobs;
+//   JobHandle move = jobs.parallelFor(0, n, 256, [&](size_t begin, size_t end) { ... });
+//   JobHandle hits = jobs.parallelFor(0, n, 256, [&](size_t begin, size_t end) { ... }, { move });
+//   jobs.wait(hits);
+//
+// The thread calling wait() helps out by running queued jobs, so a JobSystem
+// with a thread count of 1 simply runs everything on the caller.
+//
+// Given a FrameArena, job records and parallelFor bodies are allocated from it
+// rather than the heap, so spawning work every tick costs no heap allocations.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+class FrameArena;
+struct Job;
+using JobHandle = std::shared_ptr<Job>;
+
+// A parallelFor body with its type erased: a copy of the caller's callable
+// and how to call and destroy it
+struct RangeBody {
+	void (*invoke)(void* object, size_t begin, size_t end) = nullptr;
+	void (*destroy)(void* object) = nullptr;
+	void* object = nullptr;
+};
+
+
+class JobSystem {
+
+public:
+	// threadCount includes the calling thread. 0 uses every hardware thread.
+	explicit JobSystem(unsigned threadCount = 0);
+	~JobSystem();
+
+	// Worker threads keep a pointer back to the system, so it can't move
+	JobSystem(const JobSystem&) = delete;
+	JobSystem operator=(const JobSystem&) = delete;
+
+	// Public interface
+	JobHandle run(std::function<void()> fn, const std::vector<JobHandle>& dependencies = {});
+
+	// A range that fits in one chunk and has nothing to wait for runs right
+	// away on the caller, without allocating a job; the returned handle is
+	// then null, which counts as done.
+	template <typename F>
+	JobHandle parallelFor(
+		size_t begin, size_t end, size_t grain,
+		F&& fn, const std::vector<JobHandle>& dependencies = {}
+	) {
+		if (dependencies.empty() && end - begin <= grain) {
+			if (end > begin) fn(begin, end);
+			return nullptr;
+		}
+		using Body = std::decay_t<F>;
+		static_assert(alignof(Body) <= alignof(std::max_align_t), "parallelFor bodies can't be over-aligned");
+		RangeBody body;
+		body.object = new (allocateBody(sizeof(Body))) Body(std::forward<F>(fn));
+		body.invoke = [](void* object, size_t first, size_t last) { (*static_cast<Body*>(object))(first, last); };
+		body.destroy = [](void* object) { static_cast<Body*>(object)->~Body(); };
+		return spawnParallelFor(begin, end, grain, body, dependencies);
+	}
+
+	void wait(const JobHandle& job);
+	static bool isDone(const JobHandle& job);
+
+	unsigned threadCount() const { return static_cast<unsigned>(queues.size()); }
+
+	// Only change the arena while no jobs are in flight. The arena can be reset
+	// once every job allocated from it has finished and its handles are gone.
+	void setFrameArena(FrameArena* frameArena) { arena = frameArena; }
+
+private:
+	// A deque as a growable ring: unlike std::deque it never frees (or
+	// reallocates) its storage once it's big enough
+	struct WorkQueue {
+		std::mutex mutex; // guards everything below
+		std::vector<JobHandle> slots = std::vector<JobHandle>(64);
+		size_t head = 0;	// index of the oldest job
+		size_t count = 0;
+
+		bool empty() const { return count == 0; }
+		void pushBack(JobHandle job);
+		JobHandle popBack();
+		JobHandle popFront();
+	};
+
+	std::vector<std::unique_ptr<WorkQueue>> queues; // queues[0] belongs to non-worker threads
+	std::vector<std::thread> workers;
+
+	std::atomic<bool> running;
+	std::atomic<int> queued;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+
+	FrameArena* arena = nullptr;
+
+	void* allocateBody(size_t size);
+	JobHandle spawnParallelFor(
+		size_t begin, size_t end, size_t grain,
+		const RangeBody& body, const std::vector<JobHandle>& dependencies
+	);
+	void runRange(Job* job);
+	JobHandle makeJob();
+	void schedule(const JobHandle& job, const std::vector<JobHandle>& dependencies);
+	void submit(const JobHandle& job);
+	void execute(const JobHandle& job);
+	void complete(Job* job);
+
+	size_t currentQueue() const;
+	JobHandle next(size_t self);
+	void workerLoop(size_t index);
+};
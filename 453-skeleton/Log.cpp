@@ -0,0 +1,257 @@
+#include "Log.h"
+
+#include "BinaryLog.h"
+#include "SpscRing.h"
+#include "Trace.h"
+
+#include <vivid/vivid.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Log::detail {
+	std::atomic<bool> asyncEnabled{ false };
+	std::atomic<Level> runtimeLevel{ Level::Debug };
+}
+
+
+namespace {
+	using Log::Level;
+	using Log::detail::Record;
+	namespace ansi = vivid::ansi;
+
+	// Per-thread ring of pending lines. The writer thread is its only consumer.
+	struct ThreadBuffer {
+		SpscRing<Record, 1024> ring;
+		std::atomic<uint64_t> dropped{ 0 };
+	};
+
+	struct Backend {
+		std::mutex mutex; // guards buffers, draining them, and starting/stopping the writer
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+		std::thread writer;
+		std::atomic<bool> running{ false };
+		std::unique_ptr<BinaryLogWriter> binary; // replaces stdout when set
+	};
+
+	Backend& backend() {
+		static Backend instance;
+		return instance;
+	}
+
+	// Registered on the thread's first queued line. The backend shares ownership,
+	// so lines logged right before a thread exits still get written.
+	thread_local std::shared_ptr<ThreadBuffer> tlsBuffer;
+
+	// Flush to stdout once a batch gets this big
+	const size_t batchBytes = 64 * 1024;
+
+
+	void appendLine(fmt::memory_buffer& out, Level level, const char* message, size_t size) {
+		static const char* const prefixes[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+		static const std::string* const colors[] = { &ansi::green, &ansi::white, &ansi::yellow, &ansi::red };
+		size_t i = static_cast<size_t>(level);
+		fmt::format_to(out, "{}[{}]{}: ", *colors[i], prefixes[i], ansi::reset);
+		out.append(message, message + size);
+		out.push_back('\n');
+	}
+
+	void flush(fmt::memory_buffer& out) {
+		if (out.size() == 0) return;
+		std::fwrite(out.data(), 1, out.size(), stdout);
+		std::fflush(stdout);
+		out.clear();
+	}
+
+	// Formats and writes everything queued so far, with the backend's mutex
+	// held. Returns false if there was nothing.
+	bool drainLocked(Backend& b, fmt::memory_buffer& out) {
+		bool any = false;
+		fmt::memory_buffer message;
+		for (const std::shared_ptr<ThreadBuffer>& buffer : b.buffers) {
+			while (const Record* record = buffer->ring.front()) {
+				if (b.binary) {
+					b.binary->write(*record);
+					buffer->ring.pop();
+					any = true;
+					continue;
+				}
+				message.clear();
+				try {
+					record->decode(message, *record);
+				}
+				catch (const fmt::format_error& e) {
+					message.clear();
+					fmt::format_to(message, "LOG bad format string \"{}\": {}", record->formatString(), e.what());
+				}
+				appendLine(out, record->level, message.data(), message.size());
+				buffer->ring.pop();
+				any = true;
+				if (out.size() >= batchBytes) {
+					flush(out);
+				}
+			}
+			uint64_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+			if (dropped && b.binary) {
+				b.binary->writeDropped(dropped);
+				any = true;
+			}
+			else if (dropped) {
+				message.clear();
+				fmt::format_to(message, "LOG buffer full, dropped {} lines", dropped);
+				appendLine(out, Level::Warn, message.data(), message.size());
+				any = true;
+			}
+		}
+		flush(out);
+
+		// Forget buffers of threads that have exited, once they're empty
+		auto finished = [](const std::shared_ptr<ThreadBuffer>& buffer) {
+			return buffer.use_count() == 1 && buffer->ring.empty();
+		};
+		b.buffers.erase(std::remove_if(b.buffers.begin(), b.buffers.end(), finished), b.buffers.end());
+		return any;
+	}
+
+	bool drain(fmt::memory_buffer& out) {
+		Backend& b = backend();
+		std::lock_guard<std::mutex> lock(b.mutex);
+		return drainLocked(b, out);
+	}
+
+	void writerLoop() {
+		Trace::setThreadName("log writer");
+		fmt::memory_buffer out;
+		while (backend().running.load(std::memory_order_acquire)) {
+			if (!drain(out)) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	}
+}
+
+
+namespace Log {
+	void setLevel(Level level) {
+		detail::runtimeLevel.store(level, std::memory_order_relaxed);
+	}
+
+	Level getLevel() {
+		return detail::runtimeLevel.load(std::memory_order_relaxed);
+	}
+
+	bool parseLevel(std::string_view name, Level& level) {
+		static const std::pair<std::string_view, Level> names[] = {
+			{ "debug", Level::Debug }, { "info", Level::Info }, { "warn", Level::Warn }, { "error", Level::Error },
+		};
+		for (const auto& [candidate, value] : names) {
+			if (candidate == name) {
+				level = value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	bool startAsync(const std::string& binaryPath) {
+		Backend& b = backend();
+		bool opened = true;
+		{
+			std::lock_guard<std::mutex> lock(b.mutex);
+			if (b.running) return false;
+			if (!binaryPath.empty()) {
+				b.binary = std::make_unique<BinaryLogWriter>();
+				opened = b.binary->open(binaryPath);
+				if (!opened) {
+					b.binary.reset();
+				}
+			}
+			b.running = true;
+			b.writer = std::thread(writerLoop);
+			detail::asyncEnabled = true;
+		}
+		if (!opened) {
+			error("LOG couldn't create {}, logging as text", binaryPath);
+		}
+		return opened;
+	}
+
+	void flush() {
+		if (!backend().running.load(std::memory_order_acquire)) return;
+		fmt::memory_buffer out;
+		drain(out);
+	}
+
+	void stopAsync() {
+		Backend& b = backend();
+		{
+			std::lock_guard<std::mutex> lock(b.mutex);
+			if (!b.running) return;
+			detail::asyncEnabled = false;
+			b.running = false;
+		}
+		b.writer.join();
+		fmt::memory_buffer out;
+		drain(out);
+
+		std::lock_guard<std::mutex> lock(b.mutex);
+		if (b.binary) {
+			b.binary->close();
+			b.binary.reset();
+		}
+	}
+}
+
+
+namespace Log::detail {
+	Record* claim() {
+		if (!tlsBuffer) {
+			tlsBuffer = std::make_shared<ThreadBuffer>();
+			Backend& b = backend();
+			std::lock_guard<std::mutex> lock(b.mutex);
+			b.buffers.push_back(tlsBuffer);
+		}
+		Record* record = tlsBuffer->ring.claim();
+		if (!record) {
+			tlsBuffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+		return record;
+	}
+
+	void publish() {
+		tlsBuffer->ring.publish();
+	}
+
+	uint64_t now() {
+		auto sinceStart = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(sinceStart).count();
+	}
+
+	void writeLine(Level level, const char* message, size_t size) {
+		// Everything still queued was logged before this line, so it's written
+		// first; holding the mutex keeps the writer thread from cutting in
+		if (asyncEnabled.load(std::memory_order_relaxed)) {
+			Backend& b = backend();
+			std::lock_guard<std::mutex> lock(b.mutex);
+			fmt::memory_buffer out;
+			drainLocked(b, out);
+			// Lines the caller had to format still belong in the binary log
+			if (b.binary) {
+				b.binary->writeText(level, now(), std::string_view(message, size));
+				return;
+			}
+			appendLine(out, level, message, size);
+			::flush(out);
+			return;
+		}
+		fmt::memory_buffer line;
+		appendLine(line, level, message, size);
+		std::fwrite(line.data(), 1, line.size(), stdout);
+	}
+}
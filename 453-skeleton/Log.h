@@ -10,52 +10,317 @@
 //		  Log::warning("Elapsed time: {0:.2f} seconds", 1.23);
 //		  Log::error("Elapsed time: {0:.2f} seconds", 1.23);
 //
+// By default every line is formatted and written on the calling thread. After
+// Log::startAsync() a call only copies its arguments into a lock-free ring
+// owned by the calling thread; a background thread formats and writes the
+// lines in batches. Log::stopAsync() flushes whatever is left.
+//
+// In async mode the format string and any string arguments are copied into
+// the queued line, so they may go out of scope right after the call. A line
+// whose arguments don't fit, or can't be copied as bytes, is formatted on the
+// spot instead, and written once everything queued before it has been.
+//
+// Levels below LOG_MIN_LEVEL (set from CMake) are compiled out. The LOG_DEBUG,
+// LOG_INFO, LOG_WARN and LOG_ERROR macros go one step further and don't even
+// evaluate their arguments, so they suit hot paths:
+//
+//   LOG_DEBUG("tick {} took {} us", tick, expensiveToCompute());
+//
+// The functions (Log::debug() and friends) always evaluate their arguments,
+// even when the line is compiled out or filtered, so debug logging should
+// use LOG_DEBUG.
+//
+// Log::setLevel() raises the bar further at runtime.
+//
 // This code isn't intented for your review. Of course, if you feel like it, dive
 // right in.
 //------------------------------------------------------------------------------
 
 #include <fmt/format.h>
-#include <vivid/vivid.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+// 0 = DEBUG, 1 = INFO, 2 = WARN, 3 = ERROR
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
 
 
 namespace Log {
-	namespace ansi = vivid::ansi;
-	template <typename S1, typename S2, typename S3, typename... Args>
-	void _log(const S1 &prefix, const S2 &c, const S3 &format_str, Args&&... args) {
-		fmt::print(
-			"{}[{}]{}: {}\n",
-			c,
-			prefix,
-			ansi::reset,
-			fmt::format(format_str, std::forward<Args>(args)...)
-		);
+	enum class Level : uint8_t {
+		Debug,
+		Info,
+		Warn,
+		Error,
+	};
+
+	// Lowest level compiled in at all
+	constexpr Level minLevel = static_cast<Level>(LOG_MIN_LEVEL);
+
+	constexpr bool isCompiledIn(Level level) {
+		return level >= minLevel;
+	}
+
+	void setLevel(Level level);
+	Level getLevel();
+	bool parseLevel(std::string_view name, Level& level); // "debug", "info", "warn" or "error"
+
+	namespace detail {
+		extern std::atomic<Level> runtimeLevel;
+	}
+
+	inline bool isEnabled(Level level) {
+		return isCompiledIn(level) && level >= detail::runtimeLevel.load(std::memory_order_relaxed);
+	}
+
+	// With a path, lines go to a binary log file (see BinaryLog.h) instead of
+	// stdout. Returns false, and logs as text, if the file can't be created.
+	bool startAsync(const std::string& binaryPath = std::string());
+	void stopAsync();		// drains everything logged so far, then stops the writer thread
+	void flush();			// writes everything logged so far, on the calling thread
+
+
+	namespace detail {
+		// Receives the arguments of a queued line one by one, for writing them
+		// out unformatted. Types without a case of their own arrive as text.
+		class ArgSink {
+		public:
+			virtual ~ArgSink() = default;
+			virtual void putBool(bool value) = 0;
+			virtual void putChar(char value) = 0;
+			virtual void putSigned(int64_t value) = 0;
+			virtual void putUnsigned(uint64_t value) = 0;
+			virtual void putFloat(float value) = 0;
+			virtual void putDouble(double value) = 0;
+			virtual void putString(std::string_view value) = 0;
+		};
+
+		// Strings are copied into a record's payload and stored as a range
+		// within it
+		struct StoredString {
+			uint16_t offset;
+			uint16_t length;
+		};
+
+		// One queued log line: a decoder and a serializer that know the argument
+		// types, and the arguments themselves, with the strings and then the
+		// format string copied in after them.
+		struct Record {
+			static const size_t payloadSize = 208;
+
+			void (*decode)(fmt::memory_buffer& out, const Record& record);
+			void (*serialize)(ArgSink& sink, const Record& record);
+			StoredString format;
+			uint64_t time;		// nanoseconds, steady clock
+			Level level;
+			alignas(std::max_align_t) char payload[payloadSize];
+
+			std::string_view formatString() const { return std::string_view(payload + format.offset, format.length); }
+		};
+
+		uint64_t now();
+
+		extern std::atomic<bool> asyncEnabled;
+
+		Record* claim(); // slot in this thread's ring, or nullptr if it's full
+		void publish();
+		void writeLine(Level level, const char* message, size_t size);
+
+
+		template <typename T>
+		constexpr bool isString =
+			std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+			std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> ||
+			std::is_same_v<T, fmt::string_view>;
+
+		template <typename T>
+		using Stored = std::conditional_t<isString<std::decay_t<T>>, StoredString, std::decay_t<T>>;
+
+		template <typename T>
+		constexpr bool isStorable = std::is_trivially_copyable_v<Stored<T>> && std::is_trivially_destructible_v<Stored<T>>;
+
+		template <typename T>
+		size_t stringLength(const T& arg) {
+			if constexpr (isString<std::decay_t<T>>) {
+				return fmt::string_view(arg).size();
+			}
+			else {
+				return 0;
+			}
+		}
+
+		template <typename T>
+		Stored<T> store(const T& arg, char* payload, size_t& cursor) {
+			if constexpr (isString<std::decay_t<T>>) {
+				fmt::string_view s(arg);
+				std::memcpy(payload + cursor, s.data(), s.size());
+				StoredString stored{ static_cast<uint16_t>(cursor), static_cast<uint16_t>(s.size()) };
+				cursor += s.size();
+				return stored;
+			}
+			else {
+				return arg;
+			}
+		}
+
+		template <typename T>
+		const T& load(const T& value, const char*) {
+			return value;
+		}
+
+		inline fmt::string_view load(const StoredString& s, const char* payload) {
+			return fmt::string_view(payload + s.offset, s.length);
+		}
+
+		template <typename... Args>
+		void decode(fmt::memory_buffer& out, const Record& record) {
+			using Tuple = std::tuple<Stored<Args>...>;
+			const Tuple& args = *std::launder(reinterpret_cast<const Tuple*>(record.payload));
+			std::apply([&](const auto&... values) {
+				fmt::format_to(out, fmt::string_view(record.formatString()), load(values, record.payload)...);
+			}, args);
+		}
+
+		template <typename T>
+		void serializeArg(ArgSink& sink, const T& value, const char* payload) {
+			if constexpr (std::is_same_v<T, StoredString>) {
+				sink.putString(std::string_view(payload + value.offset, value.length));
+			}
+			else if constexpr (std::is_same_v<T, bool>) {
+				sink.putBool(value);
+			}
+			else if constexpr (std::is_same_v<T, char>) {
+				sink.putChar(value);
+			}
+			else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+				sink.putSigned(value);
+			}
+			else if constexpr (std::is_integral_v<T>) {
+				sink.putUnsigned(value);
+			}
+			else if constexpr (std::is_same_v<T, float>) {
+				sink.putFloat(value);
+			}
+			else if constexpr (std::is_floating_point_v<T>) {
+				sink.putDouble(static_cast<double>(value));
+			}
+			else {
+				fmt::memory_buffer text;
+				fmt::format_to(text, "{}", value);
+				sink.putString(std::string_view(text.data(), text.size()));
+			}
+		}
+
+		template <typename... Args>
+		void serialize(ArgSink& sink, const Record& record) {
+			using Tuple = std::tuple<Stored<Args>...>;
+			const Tuple& args = *std::launder(reinterpret_cast<const Tuple*>(record.payload));
+			std::apply([&](const auto&... values) {
+				(serializeArg(sink, values, record.payload), ...);
+			}, args);
+		}
+
+		// Copies the arguments into this thread's ring. Returns false if they
+		// don't fit or can't be copied as bytes; the caller then formats them.
+		template <typename... Args>
+		bool enqueue(Level level, fmt::string_view format, const Args&... args) {
+			if constexpr (!(isStorable<Args> && ...)) {
+				return false;
+			}
+			else {
+				using Tuple = std::tuple<Stored<Args>...>;
+				size_t size = sizeof(Tuple) + (stringLength(args) + ... + 0) + format.size();
+				if (size > Record::payloadSize) {
+					return false;
+				}
+				Record* record = claim();
+				if (!record) {
+					return true; // full: the line is dropped (and counted) rather than blocking
+				}
+				record->decode = &decode<Args...>;
+				record->serialize = &serialize<Args...>;
+				record->time = now();
+				record->level = level;
+				size_t cursor = sizeof(Tuple);
+				new (record->payload) Tuple{ store(args, record->payload, cursor)... };
+				record->format = store(format, record->payload, cursor);
+				publish();
+				return true;
+			}
+		}
+	}
+
+
+	template <typename S, typename... Args>
+	void _log(Level level, const S &format_str, const Args&... args) {
+		if (!isEnabled(level)) return;
+		if (detail::asyncEnabled.load(std::memory_order_relaxed) && detail::enqueue(level, fmt::to_string_view(format_str), args...)) {
+			return;
+		}
+		fmt::memory_buffer message;
+		fmt::format_to(message, format_str, args...);
+		detail::writeLine(level, message.data(), message.size());
 	}
 
 
 	template <typename S, typename... Args>
 	void debug(const S &format_str, Args&&... args) {
-		_log("DEBUG", ansi::green, format_str, args...);
+		if constexpr (isCompiledIn(Level::Debug)) {
+			_log(Level::Debug, format_str, args...);
+		}
 	}
 
 	template <typename S, typename... Args>
 	void info(const S &format_str, Args&&... args) {
-		_log("INFO", ansi::white, format_str, args...);
+		if constexpr (isCompiledIn(Level::Info)) {
+			_log(Level::Info, format_str, args...);
+		}
 	}
 
 	template <typename S, typename... Args>
 	void warning(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		if constexpr (isCompiledIn(Level::Warn)) {
+			_log(Level::Warn, format_str, args...);
+		}
 	}
 	template <typename S, typename... Args>
 	void warn(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		if constexpr (isCompiledIn(Level::Warn)) {
+			_log(Level::Warn, format_str, args...);
+		}
 	}
 
 	template <typename S, typename... Args>
 	void error(const S &format_str, Args&&... args) {
-		_log("ERROR", ansi::red, format_str, args...);
+		if constexpr (isCompiledIn(Level::Error)) {
+			_log(Level::Error, format_str, args...);
+		}
 	}
 
 
 }
+
+
+// Like Log::debug() and friends, but a call below the compiled-in or runtime
+// level doesn't evaluate its arguments either
+#define LOG_AT(level, fn, ...) \
+	do { \
+		if constexpr (Log::isCompiledIn(level)) { \
+			if (Log::isEnabled(level)) fn(__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_DEBUG(...) LOG_AT(Log::Level::Debug, Log::debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(Log::Level::Info, Log::info, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(Log::Level::Warn, Log::warn, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(Log::Level::Error, Log::error, __VA_ARGS__)
@@ -0,0 +1,142 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+	const size_t initialCapacity = 4 << 20;
+}
+
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+
+bool MappedFile::append(const void* data, size_t bytes) {
+	if (!base) return false;
+	if (size + bytes > capacity && !map(std::max(capacity * 2, size + bytes))) {
+		return false;
+	}
+	std::memcpy(base + size, data, bytes);
+	size += bytes;
+	return true;
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+	close();
+	file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return false;
+	}
+	size = 0;
+	return map(initialCapacity);
+}
+
+
+bool MappedFile::map(size_t newCapacity) {
+	unmap();
+	LARGE_INTEGER length;
+	length.QuadPart = static_cast<LONGLONG>(newCapacity);
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, length.HighPart, length.LowPart, nullptr);
+	if (!mapping) {
+		return false;
+	}
+	base = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, newCapacity));
+	if (!base) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+		return false;
+	}
+	capacity = newCapacity;
+	return true;
+}
+
+
+void MappedFile::unmap() {
+	if (base) {
+		UnmapViewOfFile(base);
+		base = nullptr;
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+}
+
+
+void MappedFile::close() {
+	if (!file) return;
+	unmap();
+	LARGE_INTEGER length;
+	length.QuadPart = static_cast<LONGLONG>(size);
+	SetFilePointerEx(file, length, nullptr, FILE_BEGIN);
+	SetEndOfFile(file);
+	CloseHandle(file);
+	file = nullptr;
+	capacity = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+	close();
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+	size = 0;
+	return map(initialCapacity);
+}
+
+
+bool MappedFile::map(size_t newCapacity) {
+	unmap();
+	if (ftruncate(fd, static_cast<off_t>(newCapacity)) != 0) {
+		return false;
+	}
+	void* address = mmap(nullptr, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		return false;
+	}
+	base = static_cast<char*>(address);
+	capacity = newCapacity;
+	return true;
+}
+
+
+void MappedFile::unmap() {
+	if (base) {
+		munmap(base, capacity);
+		base = nullptr;
+	}
+}
+
+
+void MappedFile::close() {
+	if (fd < 0) return;
+	unmap();
+	if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+		// Leaves trailing zeros, which readers treat as the end of the data
+	}
+	::close(fd);
+	fd = -1;
+	capacity = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// An append-only file written through a memory mapping.
+//
+// Appending is a memcpy into the mapping; the operating system writes the
+// pages back in its own time. The file grows in chunks (filled with zeros) and
+// is cut back to the bytes actually written when closed.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <string>
+
+
+class MappedFile {
+
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile operator=(const MappedFile&) = delete;
+
+	// Public interface
+	bool open(const std::string& path);
+	bool append(const void* data, size_t size);
+	void close();
+
+	bool isOpen() const { return base != nullptr; }
+	size_t getSize() const { return size; }
+
+private:
+	char* base = nullptr;
+	size_t capacity = 0;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+
+	bool map(size_t newCapacity);
+	void unmap();
+};
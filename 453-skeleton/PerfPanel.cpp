@@ -0,0 +1,81 @@
+#include "PerfPanel.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+
+
+PerfPanel::PerfPanel(size_t historySize)
+	: interval(historySize)
+	, cpu(historySize)
+	, gpu(historySize)
+{}
+
+
+void PerfPanel::addFrame(const Frame& frame) {
+	last = frame;
+	interval.add(static_cast<float>(frame.intervalMs));
+	cpu.add(static_cast<float>(frame.cpuMs));
+}
+
+
+void PerfPanel::addGpuTime(double ms) {
+	gpu.add(static_cast<float>(ms));
+}
+
+
+void PerfPanel::draw() {
+	if (!visible) return;
+
+	ImGui::SetNextWindowPos(ImVec2(5, 60), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowBgAlpha(0.7f);
+	ImGui::Begin("Performance (F3)", &visible, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings);
+
+	drawHistory("frame", interval);
+	drawHistory("cpu", cpu);
+	drawHistory("gpu", gpu);
+
+	ImGui::Separator();
+	ImGui::Text("draw calls      %u", last.counters.drawCalls);
+	ImGui::Text("state changes   %u", last.counters.stateChanges);
+	ImGui::Text("uniform uploads %u", last.counters.uniformUploads);
+	ImGui::Text("triangles       %llu", static_cast<unsigned long long>(last.counters.triangles));
+	ImGui::Text("allocations     %llu (%llu bytes)",
+		static_cast<unsigned long long>(last.allocations), static_cast<unsigned long long>(last.allocatedBytes));
+
+	ImGui::End();
+}
+
+
+void PerfPanel::drawHistory(const char* label, History& history) {
+	if (history.count == 0) {
+		ImGui::Text("%-5s  (waiting)", label);
+		return;
+	}
+	float p50 = history.percentile(0.50f);
+	float p95 = history.percentile(0.95f);
+	float p99 = history.percentile(0.99f);
+	ImGui::Text("%-5s  p50 %6.2f  p95 %6.2f  p99 %6.2f ms", label, p50, p95, p99);
+
+	// Plot oldest to newest; values_offset starts the ring at its oldest entry
+	int offset = history.count == history.values.size() ? static_cast<int>(history.next) : 0;
+	ImGui::PushID(label);
+	ImGui::PlotHistogram("", history.values.data(), static_cast<int>(history.count), offset,
+		nullptr, 0.f, std::max(p99 * 1.25f, 1.f), ImVec2(300, 40));
+	ImGui::PopID();
+}
+
+
+void PerfPanel::History::add(float value) {
+	values[next] = value;
+	next = (next + 1) % values.size();
+	count = std::min(count + 1, values.size());
+}
+
+
+float PerfPanel::History::percentile(float p) {
+	std::copy(values.begin(), values.begin() + count, scratch.begin());
+	size_t rank = std::min(count - 1, static_cast<size_t>(p * count));
+	std::nth_element(scratch.begin(), scratch.begin() + rank, scratch.begin() + count);
+	return scratch[rank];
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// An ImGui panel with frame timings and render counters.
+//
+// Keeps the last few seconds of frames and shows CPU and GPU time as rolling
+// histograms with p50/p95/p99, next to the latest frame's GL counters and heap
+// allocations.
+//------------------------------------------------------------------------------
+
+#include "RenderStats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+class PerfPanel {
+
+public:
+	struct Frame {
+		double intervalMs = 0.0;	// start of the previous frame to the start of this one
+		double cpuMs = 0.0;			// this frame's CPU work, up to swapBuffers
+		RenderCounters counters;
+		uint64_t allocations = 0;	// heap allocations on every thread
+		uint64_t allocatedBytes = 0;
+	};
+
+	explicit PerfPanel(size_t historySize = 240);
+
+	// Public interface
+	void addFrame(const Frame& frame);
+	void addGpuTime(double ms);
+
+	void draw();
+
+	bool isVisible() const { return visible; }
+	void toggle() { visible = !visible; }
+
+private:
+	struct History {
+		explicit History(size_t size) : values(size, 0.f), scratch(size) {}
+
+		void add(float value);
+		float percentile(float p);
+
+		std::vector<float> values;	// ring, oldest at `next` once full
+		std::vector<float> scratch;
+		size_t next = 0;
+		size_t count = 0;
+	};
+
+	History interval;
+	History cpu;
+	History gpu;
+	Frame last;
+	bool visible = false;
+
+	static void drawHistory(const char* label, History& history);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Counters for the GL work done in one frame.
+//
+// The thin GL wrappers (GPU_Geometry, Texture, ShaderProgram) count their own
+// binds; draw code counts its draw calls and uniform uploads. main() resets the
+// counters at the start of every frame. Only the render thread touches them.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+
+
+struct RenderCounters {
+	uint32_t drawCalls = 0;
+	uint32_t stateChanges = 0;		// program, vertex array and texture binds
+	uint32_t uniformUploads = 0;
+	uint64_t triangles = 0;
+};
+
+
+namespace RenderStats {
+	inline RenderCounters frame;
+
+	inline void countStateChange() { frame.stateChanges++; }
+	inline void countUniformUpload() { frame.uniformUploads++; }
+
+	inline void countDraw(uint64_t triangles, uint32_t instances = 1) {
+		frame.drawCalls++;
+		frame.triangles += triangles * instances;
+	}
+}
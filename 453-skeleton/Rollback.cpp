@@ -0,0 +1,76 @@
+#include "Rollback.h"
+
+#include <algorithm>
+
+
+Rollback::Rollback(Game& game, size_t capacity)
+	: game(game)
+	, history(std::max<size_t>(capacity, 1), Entry{ game.getState(), TickInput() })
+	, oldest(game.getState().header().tick)
+	, dirty(noCorrection)
+{}
+
+
+void Rollback::tick(const TickInput& input) {
+	save(input);
+	game.tick(input);
+}
+
+
+bool Rollback::rewind(uint64_t tick) {
+	if (tick < oldest || tick > getTick()) {
+		return false;
+	}
+	if (tick < getTick()) {
+		game.restore(entry(tick).state);
+	}
+	// Corrections past the new present are gone with the ticks they were for
+	if (dirty >= tick) {
+		dirty = noCorrection;
+	}
+	return true;
+}
+
+
+bool Rollback::correct(uint64_t tick, const TickInput& input) {
+	if (tick < oldest || tick >= getTick()) {
+		return false;
+	}
+	entry(tick).input = input;
+	dirty = std::min(dirty, tick);
+	return true;
+}
+
+
+uint64_t Rollback::resimulate() {
+	if (dirty == noCorrection) {
+		return 0;
+	}
+	uint64_t now = getTick();
+	uint64_t from = dirty;
+	dirty = noCorrection;
+
+	game.restore(entry(from).state);
+	for (uint64_t t = from; t < now; t++) {
+		Entry& e = entry(t);
+		// The start state of tick `from` is unchanged; later ones get refreshed
+		if (t != from) {
+			e.state.restore(game.getState());
+		}
+		game.tick(e.input);
+	}
+	return now - from;
+}
+
+
+void Rollback::save(const TickInput& input) {
+	uint64_t now = getTick();
+	Entry& e = entry(now);
+	e.state.restore(game.getState());
+	e.input = input;
+
+	// The entry just written pushed the oldest one out of the window
+	if (now - oldest >= history.size()) {
+		oldest = now + 1 - history.size();
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Keeps the last N ticks of a Game so it can be rewound and resimulated.
+//
+// Every tick stores the state the tick started from plus the input it was run
+// with, in a ring of preallocated GameStates. Saving is one memcpy, so ticking
+// through a Rollback never allocates.
+//
+// Rollback netcode corrects inputs after the fact:
+//   rollback.correct(t, remoteInput);  // any tick still in the window
+//   rollback.resimulate();             // replays from the earliest correction
+//
+// Time-travel debugging just rewinds:
+//   rollback.rewind(rollback.getTick() - 1);
+//------------------------------------------------------------------------------
+
+#include "Game.h"
+#include "GameState.h"
+#include "TickInput.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+class Rollback {
+
+public:
+	// Remembers up to `capacity` ticks of history (at least one)
+	Rollback(Game& game, size_t capacity);
+
+	// Public interface
+	void tick(const TickInput& input);
+
+	// Goes back to the start of `tick`, forgetting everything after it.
+	// Fails if the tick has fallen out of the window or hasn't happened yet.
+	bool rewind(uint64_t tick);
+
+	// Replaces the input of a past tick. Nothing is recomputed until resimulate().
+	bool correct(uint64_t tick, const TickInput& input);
+
+	// Re-runs every tick from the earliest correction up to now.
+	// Returns the number of ticks simulated again.
+	uint64_t resimulate();
+
+	uint64_t getTick() const { return game.getState().header().tick; }
+	uint64_t getOldestTick() const { return oldest; }
+	size_t getCapacity() const { return history.size(); }
+
+private:
+	struct Entry {
+		GameState state;	// state at the start of the tick
+		TickInput input;	// input the tick was run with
+	};
+
+	Game& game;
+	std::vector<Entry> history; // tick t lives in history[t % capacity]
+	uint64_t oldest;
+	uint64_t dirty;				// earliest corrected tick, or noCorrection
+
+	static const uint64_t noCorrection = UINT64_MAX;
+
+	Entry& entry(uint64_t tick) { return history[tick % history.size()]; }
+	void save(const TickInput& input);
+};
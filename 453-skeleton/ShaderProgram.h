@@ -3,6 +3,7 @@
 #include "Shader.h"
 
 #include "GLHandles.h"
+#include "RenderStats.h"
 
 #include <GL/glew.h>
 
@@ -23,7 +24,7 @@ public:
 
 	// Public interface
 	bool recompile();
-	void use() const { glUseProgram(programID); }
+	void use() const { glUseProgram(programID); RenderStats::countStateChange(); }
 
 	void friend attach(ShaderProgram& sp, Shader& s);
 
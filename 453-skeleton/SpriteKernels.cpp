@@ -0,0 +1,434 @@
+#include "SpriteKernels.h"
+
+#include "SpriteKernelsSimd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if SPRITE_KERNELS_SSE
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER) && SPRITE_KERNELS_SSE
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+
+using namespace SpriteKernels::detail;
+
+static_assert(sizeof(Affine2D) == 6 * sizeof(float), "the kernels write Affine2D as 6 floats");
+
+
+namespace {
+	SpriteKernels::Isa Detect() {
+		using SpriteKernels::Isa;
+#if SPRITE_KERNELS_SSE
+		bool avx2 = false;
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		// The OS has to save the YMM registers too
+		if (maxLeaf >= 7 && fma && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+#else
+		// These check that the OS saves the YMM registers as well
+		__builtin_cpu_init();
+		avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+		return avx2 && avx2Built ? Isa::AVX2 : Isa::SSE;
+#else
+		return Isa::Scalar;
+#endif
+	}
+
+	std::atomic<SpriteKernels::Isa>& ActiveIsa() {
+		static std::atomic<SpriteKernels::Isa> isa{ SpriteKernels::best() };
+		return isa;
+	}
+
+
+	// The scalar form of the polynomial sine and cosine (see SpriteKernelsSimd.h)
+	void SinCos(float angle, float& sine, float& cosine) {
+		float x = std::fabs(angle);
+		// Round the octant up to even, so x ends up in [-PI/4, PI/4]
+		int j = (static_cast<int>(x * fourOverPi) + 1) & ~1;
+		float y = static_cast<float>(j);
+		x = ((x - y * reduce1) - y * reduce2) - y * reduce3;
+
+		float z = x * x;
+		float cosPoly = ((cos1 * z + cos2) * z + cos3) * z * z - 0.5f * z + 1.f;
+		float sinPoly = ((sin1 * z + sin2) * z + sin3) * z * x + x;
+
+		bool swap = (j & 2) != 0;
+		sine = swap ? cosPoly : sinPoly;
+		cosine = swap ? sinPoly : cosPoly;
+		if (((j & 4) != 0) != (angle < 0.f)) sine = -sine;
+		if (((j - 2) & 4) == 0) cosine = -cosine;
+	}
+
+	void ComposeScalar(const ComposeArgs& args, size_t begin) {
+		const float* child = args.child;
+		for (size_t i = begin; i < args.count; i++) {
+			float s, c;
+			SinCos(args.angle[i] + args.angleOffset, s, c);
+			float sx = args.sizeX * args.scale[i];
+			float sy = args.sizeY * args.scale[i];
+			float a = c * sx;
+			float b = s * sx;
+			float cc = -s * sy;
+			float d = c * sy;
+			float tx = args.x[i];
+			float ty = args.y[i];
+
+			float* out = args.out + 6 * i;
+			if (child) {
+				out[0] = a * child[0] + cc * child[1];
+				out[1] = b * child[0] + d * child[1];
+				out[2] = a * child[2] + cc * child[3];
+				out[3] = b * child[2] + d * child[3];
+				out[4] = a * child[4] + cc * child[5] + tx;
+				out[5] = b * child[4] + d * child[5] + ty;
+			}
+			else {
+				out[0] = a;
+				out[1] = b;
+				out[2] = cc;
+				out[3] = d;
+				out[4] = tx;
+				out[5] = ty;
+			}
+		}
+	}
+
+	void Compose(const ComposeArgs& args) {
+		size_t done = 0;
+		switch (ActiveIsa().load(std::memory_order_relaxed)) {
+		case SpriteKernels::Isa::AVX2: done = composeAvx2(args); break;
+		case SpriteKernels::Isa::SSE: done = composeSse(args); break;
+		case SpriteKernels::Isa::Scalar: break;
+		}
+		ComposeScalar(args, done);
+	}
+
+	// `begin` is a multiple of 64
+	void HitTestScalar(const HitArgs& args, size_t begin) {
+		for (size_t word = begin / 64; word * 64 < args.count; word++) {
+			uint64_t bits = 0;
+			size_t end = std::min(args.count, word * 64 + 64);
+			for (size_t i = word * 64; i < end; i++) {
+				float dx = args.x[i] - args.pointX;
+				float dy = args.y[i] - args.pointY;
+				float distance = dx * dx + dy * dy;
+				float range = args.pointRadius + (args.radius ? args.radius[i] : 0.f);
+				bool hit = distance < range * range && !(args.ignore && args.ignore[i]);
+				bits |= static_cast<uint64_t>(hit) << (i - word * 64);
+			}
+			args.hits[word] = bits;
+		}
+	}
+
+
+	// |q - point| in Q16.16, clamped to fixedOffsetLimit
+	int32_t FixedOffset(float q, int32_t point) {
+		uint32_t offset = static_cast<uint32_t>(static_cast<int32_t>(q * fixedOne)) - static_cast<uint32_t>(point);
+		uint32_t magnitude = offset >> 31 ? 0u - offset : offset;
+		return static_cast<int32_t>(std::min(magnitude, static_cast<uint32_t>(fixedOffsetLimit)));
+	}
+
+	// `begin` is a multiple of 64
+	void HitTestFixedScalar(const FixedHitArgs& args, size_t begin) {
+		for (size_t word = begin / 64; word * 64 < args.count; word++) {
+			uint64_t bits = 0;
+			size_t end = std::min(args.count, word * 64 + 64);
+			for (size_t i = word * 64; i < end; i++) {
+				int32_t dx = FixedOffset(args.x[i], args.pointX);
+				int32_t dy = FixedOffset(args.y[i], args.pointY);
+				bool hit = dx * dx + dy * dy < args.rangeSquared && !(args.ignore && args.ignore[i]);
+				bits |= static_cast<uint64_t>(hit) << (i - word * 64);
+			}
+			args.hits[word] = bits;
+		}
+	}
+
+
+#if SPRITE_KERNELS_SSE
+	__m128 Select(__m128 mask, __m128 ifSet, __m128 ifClear) {
+		return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, ifClear));
+	}
+
+	// SinCos() on four angles
+	void SinCos4(__m128 angle, __m128& sine, __m128& cosine) {
+		const __m128 signMask = _mm_set1_ps(-0.f);
+		__m128 x = _mm_andnot_ps(signMask, angle);
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(fourOverPi)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(j);
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(reduce1)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(reduce2)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(reduce3)));
+
+		__m128 z = _mm_mul_ps(x, x);
+		__m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(cos1), z), _mm_set1_ps(cos2));
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(cos3));
+		cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+		cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.f));
+		__m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sin1), z), _mm_set1_ps(sin2));
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(sin3));
+		sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+		__m128 sinSign = _mm_xor_ps(_mm_and_ps(angle, signMask), _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		sine = _mm_xor_ps(Select(swap, cosPoly, sinPoly), sinSign);
+		cosine = _mm_xor_ps(Select(swap, sinPoly, cosPoly), cosSign);
+	}
+#endif
+}
+
+
+namespace SpriteKernels::detail {
+#if SPRITE_KERNELS_SSE
+	size_t composeSse(const ComposeArgs& args) {
+		const size_t groups = args.count / 4 * 4;
+		const __m128 offset = _mm_set1_ps(args.angleOffset);
+		const __m128 sizeX = _mm_set1_ps(args.sizeX);
+		const __m128 sizeY = _mm_set1_ps(args.sizeY);
+		for (size_t i = 0; i < groups; i += 4) {
+			__m128 s, c;
+			SinCos4(_mm_add_ps(_mm_loadu_ps(args.angle + i), offset), s, c);
+			__m128 scale = _mm_loadu_ps(args.scale + i);
+			__m128 sx = _mm_mul_ps(sizeX, scale);
+			__m128 sy = _mm_mul_ps(sizeY, scale);
+			__m128 a = _mm_mul_ps(c, sx);
+			__m128 b = _mm_mul_ps(s, sx);
+			__m128 cc = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(s, sy));
+			__m128 d = _mm_mul_ps(c, sy);
+			__m128 tx = _mm_loadu_ps(args.x + i);
+			__m128 ty = _mm_loadu_ps(args.y + i);
+
+			if (args.child) {
+				const float* l = args.child;
+				__m128 a2 = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(l[0])), _mm_mul_ps(cc, _mm_set1_ps(l[1])));
+				__m128 b2 = _mm_add_ps(_mm_mul_ps(b, _mm_set1_ps(l[0])), _mm_mul_ps(d, _mm_set1_ps(l[1])));
+				__m128 c2 = _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(l[2])), _mm_mul_ps(cc, _mm_set1_ps(l[3])));
+				__m128 d2 = _mm_add_ps(_mm_mul_ps(b, _mm_set1_ps(l[2])), _mm_mul_ps(d, _mm_set1_ps(l[3])));
+				tx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(l[4])), _mm_mul_ps(cc, _mm_set1_ps(l[5]))), tx);
+				ty = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b, _mm_set1_ps(l[4])), _mm_mul_ps(d, _mm_set1_ps(l[5]))), ty);
+				a = a2;
+				b = b2;
+				cc = c2;
+				d = d2;
+			}
+
+			// Six arrays of four into four transforms of six: pair the
+			// columns up, then move them around two floats at a time
+			__m128d p0 = _mm_castps_pd(_mm_unpacklo_ps(a, b));
+			__m128d p1 = _mm_castps_pd(_mm_unpackhi_ps(a, b));
+			__m128d q0 = _mm_castps_pd(_mm_unpacklo_ps(cc, d));
+			__m128d q1 = _mm_castps_pd(_mm_unpackhi_ps(cc, d));
+			__m128d r0 = _mm_castps_pd(_mm_unpacklo_ps(tx, ty));
+			__m128d r1 = _mm_castps_pd(_mm_unpackhi_ps(tx, ty));
+			double* out = reinterpret_cast<double*>(args.out + 6 * i);
+			_mm_storeu_pd(out + 0, _mm_unpacklo_pd(p0, q0));
+			_mm_storeu_pd(out + 2, _mm_shuffle_pd(r0, p0, 2));
+			_mm_storeu_pd(out + 4, _mm_unpackhi_pd(q0, r0));
+			_mm_storeu_pd(out + 6, _mm_unpacklo_pd(p1, q1));
+			_mm_storeu_pd(out + 8, _mm_shuffle_pd(r1, p1, 2));
+			_mm_storeu_pd(out + 10, _mm_unpackhi_pd(q1, r1));
+		}
+		return groups;
+	}
+
+	size_t hitTestSse(const HitArgs& args) {
+		const size_t groups = args.count / 64 * 64;
+		const __m128 pointX = _mm_set1_ps(args.pointX);
+		const __m128 pointY = _mm_set1_ps(args.pointY);
+		const __m128 pointRadius = _mm_set1_ps(args.pointRadius);
+		for (size_t word = 0; word * 64 < groups; word++) {
+			uint64_t bits = 0;
+			for (size_t lane = 0; lane < 64; lane += 4) {
+				size_t i = word * 64 + lane;
+				__m128 dx = _mm_sub_ps(_mm_loadu_ps(args.x + i), pointX);
+				__m128 dy = _mm_sub_ps(_mm_loadu_ps(args.y + i), pointY);
+				__m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+				__m128 range = args.radius ? _mm_add_ps(pointRadius, _mm_loadu_ps(args.radius + i)) : pointRadius;
+				__m128 hit = _mm_cmplt_ps(distance, _mm_mul_ps(range, range));
+				if (args.ignore) {
+					__m128i ignore = _mm_loadu_si128(reinterpret_cast<const __m128i*>(args.ignore + i));
+					hit = _mm_and_ps(hit, _mm_castsi128_ps(_mm_cmpeq_epi32(ignore, _mm_setzero_si128())));
+				}
+				bits |= static_cast<uint64_t>(_mm_movemask_ps(hit)) << lane;
+			}
+			args.hits[word] = bits;
+		}
+		return groups;
+	}
+
+	size_t hitTestFixedSse(const FixedHitArgs& args) {
+		const size_t groups = args.count / 64 * 64;
+		const __m128 one = _mm_set1_ps(fixedOne);
+		const __m128i pointX = _mm_set1_epi32(args.pointX);
+		const __m128i pointY = _mm_set1_epi32(args.pointY);
+		const __m128i limit = _mm_set1_epi32(fixedOffsetLimit);
+		const __m128i rangeSquared = _mm_set1_epi32(args.rangeSquared);
+		// FixedOffset() four at a time. SSE2 has no absolute value or
+		// unsigned minimum; anything negative after the abs is 2^31.
+		auto offset = [&](const float* q, __m128i point) {
+			__m128i d = _mm_sub_epi32(_mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(q), one)), point);
+			__m128i sign = _mm_srai_epi32(d, 31);
+			d = _mm_sub_epi32(_mm_xor_si128(d, sign), sign);
+			__m128i over = _mm_or_si128(_mm_cmpgt_epi32(d, limit), _mm_srai_epi32(d, 31));
+			return _mm_or_si128(_mm_andnot_si128(over, d), _mm_and_si128(over, limit));
+		};
+		for (size_t word = 0; word * 64 < groups; word++) {
+			uint64_t bits = 0;
+			for (size_t lane = 0; lane < 64; lane += 4) {
+				size_t i = word * 64 + lane;
+				// dx in the low half of each lane and dy in the high half, so
+				// one multiply-add gives dx * dx + dy * dy
+				__m128i pairs = _mm_or_si128(offset(args.x + i, pointX), _mm_slli_epi32(offset(args.y + i, pointY), 16));
+				__m128i hit = _mm_cmplt_epi32(_mm_madd_epi16(pairs, pairs), rangeSquared);
+				if (args.ignore) {
+					__m128i ignore = _mm_loadu_si128(reinterpret_cast<const __m128i*>(args.ignore + i));
+					hit = _mm_and_si128(hit, _mm_cmpeq_epi32(ignore, _mm_setzero_si128()));
+				}
+				bits |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(hit))) << lane;
+			}
+			args.hits[word] = bits;
+		}
+		return groups;
+	}
+
+	size_t transformPointsSse(const float* transform, const float* x, const float* y, float* outX, float* outY, size_t count) {
+		const size_t groups = count / 4 * 4;
+		const __m128 t0 = _mm_set1_ps(transform[0]);
+		const __m128 t1 = _mm_set1_ps(transform[1]);
+		const __m128 t2 = _mm_set1_ps(transform[2]);
+		const __m128 t3 = _mm_set1_ps(transform[3]);
+		const __m128 t4 = _mm_set1_ps(transform[4]);
+		const __m128 t5 = _mm_set1_ps(transform[5]);
+		for (size_t i = 0; i < groups; i += 4) {
+			__m128 px = _mm_loadu_ps(x + i);
+			__m128 py = _mm_loadu_ps(y + i);
+			_mm_storeu_ps(outX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(t0, px), _mm_mul_ps(t2, py)), t4));
+			_mm_storeu_ps(outY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(t1, px), _mm_mul_ps(t3, py)), t5));
+		}
+		return groups;
+	}
+#else
+	size_t composeSse(const ComposeArgs&) {
+		return 0;
+	}
+
+	size_t hitTestSse(const HitArgs&) {
+		return 0;
+	}
+
+	size_t hitTestFixedSse(const FixedHitArgs&) {
+		return 0;
+	}
+
+	size_t transformPointsSse(const float*, const float*, const float*, float*, float*, size_t) {
+		return 0;
+	}
+#endif
+}
+
+
+namespace SpriteKernels {
+	Isa best() {
+		static const Isa isa = Detect();
+		return isa;
+	}
+
+	Isa active() {
+		return ActiveIsa().load(std::memory_order_relaxed);
+	}
+
+	bool use(Isa isa) {
+		if (static_cast<int>(isa) > static_cast<int>(best())) {
+			return false;
+		}
+		ActiveIsa().store(isa, std::memory_order_relaxed);
+		return true;
+	}
+
+	const char* name(Isa isa) {
+		switch (isa) {
+		case Isa::Scalar: return "scalar";
+		case Isa::SSE: return "sse";
+		case Isa::AVX2: return "avx2";
+		}
+		return "?";
+	}
+
+	bool parseIsa(const std::string& text, Isa& isa) {
+		for (Isa candidate : { Isa::Scalar, Isa::SSE, Isa::AVX2 }) {
+			if (text == name(candidate)) {
+				isa = candidate;
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	void compose(const Sprites& sprites, float angleOffset, glm::vec2 size, Affine2D* out) {
+		Compose({
+			sprites.x, sprites.y, sprites.angle, sprites.scale, sprites.count,
+			angleOffset, size.x, size.y, nullptr, reinterpret_cast<float*>(out)
+		});
+	}
+
+	void composeChildren(const Sprites& sprites, float angleOffset, glm::vec2 size, const Affine2D& child, Affine2D* out) {
+		Compose({
+			sprites.x, sprites.y, sprites.angle, sprites.scale, sprites.count,
+			angleOffset, size.x, size.y, reinterpret_cast<const float*>(&child), reinterpret_cast<float*>(out)
+		});
+	}
+
+	void hitTest(glm::vec2 point, float pointRadius, const float* x, const float* y, const float* radius, const uint32_t* ignore, size_t count, uint64_t* hits) {
+		HitArgs args{ point.x, point.y, pointRadius, x, y, radius, ignore, count, hits };
+		size_t done = 0;
+		switch (active()) {
+		case Isa::AVX2: done = hitTestAvx2(args); break;
+		case Isa::SSE: done = hitTestSse(args); break;
+		case Isa::Scalar: break;
+		}
+		HitTestScalar(args, done);
+	}
+
+	void hitTestFixed(int32_t pointX, int32_t pointY, int32_t range, const float* x, const float* y, const uint32_t* ignore, size_t count, uint64_t* hits) {
+		FixedHitArgs args{ pointX, pointY, range * range, x, y, ignore, count, hits };
+		size_t done = 0;
+		switch (active()) {
+		case Isa::AVX2: done = hitTestFixedAvx2(args); break;
+		case Isa::SSE: done = hitTestFixedSse(args); break;
+		case Isa::Scalar: break;
+		}
+		HitTestFixedScalar(args, done);
+	}
+
+	void transformPoints(const Affine2D& transform, const float* x, const float* y, float* outX, float* outY, size_t count) {
+		const float* t = reinterpret_cast<const float*>(&transform);
+		size_t done = 0;
+		switch (active()) {
+		case Isa::AVX2: done = transformPointsAvx2(t, x, y, outX, outY, count); break;
+		case Isa::SSE: done = transformPointsSse(t, x, y, outX, outY, count); break;
+		case Isa::Scalar: break;
+		}
+		for (size_t i = done; i < count; i++) {
+			glm::vec2 p = transform.apply(glm::vec2(x[i], y[i]));
+			outX[i] = p.x;
+			outY[i] = p.y;
+		}
+	}
+}
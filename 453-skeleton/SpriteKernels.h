@@ -0,0 +1,97 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Batch kernels over sprites stored as separate arrays (positions, angles,
+// scales): their world transforms, ready to upload to the GPU, and hit tests
+// against them.
+//
+// Each kernel has a scalar, an SSE and an AVX2 version. The first call picks
+// the widest one the CPU supports; use() switches to another, which is how the
+// microbenchmarks compare them. Every version computes sines and cosines with
+// the same polynomial, so they agree to within rounding. The hit tests agree
+// exactly, so a simulation can use any of them.
+//
+// Example:
+//   SpriteKernels::Sprites diamonds{ x, y, angle, scale, count };
+//   SpriteKernels::compose(diamonds, 0.f, glm::vec2(1.f), transforms);
+//------------------------------------------------------------------------------
+
+#include "Affine2D.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace SpriteKernels {
+	enum class Isa {
+		Scalar,
+		SSE,
+		AVX2,
+	};
+
+	// The best the CPU supports; never more than the build has kernels for
+	Isa best();
+	// The one the kernels below run with
+	Isa active();
+	// False, and nothing changes, if the CPU can't run `isa`
+	bool use(Isa isa);
+	const char* name(Isa isa);
+	// "scalar", "sse" or "avx2"; false if `name` is none of them
+	bool parseIsa(const std::string& name, Isa& isa);
+
+
+	// One entry per sprite in each array
+	struct Sprites {
+		const float* x;
+		const float* y;
+		const float* angle;		// counterclockwise, in radians
+		const float* scale;		// uniform, on top of the size passed in
+		size_t count;
+	};
+
+	// out[i] = translate(x[i], y[i]) * rotate(angle[i] + angleOffset) * scale(size * scale[i])
+	void compose(const Sprites& sprites, float angleOffset, glm::vec2 size, Affine2D* out);
+
+	// As compose(), followed by `child`: out[i] = compose(sprite i) * child.
+	// For things that move with their sprite, like a fire around its diamond.
+	void composeChildren(const Sprites& sprites, float angleOffset, glm::vec2 size, const Affine2D& child, Affine2D* out);
+
+	// (outX[i], outY[i]) = transform.apply((x[i], y[i])); the output may be the input
+	void transformPoints(const Affine2D& transform, const float* x, const float* y, float* outX, float* outY, size_t count);
+
+
+	// Bit i % 64 of hits[i / 64] is set when the circle around (x[i], y[i])
+	// with radius[i] (0 if radius is null) overlaps the one around `point`,
+	// and ignore[i] (if given) is 0. Writes (count + 63) / 64 words. Tests
+	// squared distances, 8 sprites at a time with AVX2.
+	void hitTest(glm::vec2 point, float pointRadius, const float* x, const float* y, const float* radius, const uint32_t* ignore, size_t count, uint64_t* hits);
+
+	// hitTest() for the fixed-point simulation (see Fixed.h): x and y hold
+	// Q16.16 values, and the point and range are Q16.16 integers, with range
+	// below 0.5. Squared distances are computed exactly in integers, so every
+	// version gives the same bits whatever the compiler does with floats.
+	void hitTestFixed(int32_t pointX, int32_t pointY, int32_t range, const float* x, const float* y, const uint32_t* ignore, size_t count, uint64_t* hits);
+
+	// Calls fn(i) for every i whose bit is set, in increasing order
+	template <typename Fn>
+	void forEachHit(const uint64_t* hits, size_t count, Fn fn) {
+		for (size_t word = 0; word < (count + 63) / 64; word++) {
+			for (uint64_t bits = hits[word]; bits; bits &= bits - 1) {
+#if defined(_MSC_VER)
+				unsigned long bit;
+				_BitScanForward64(&bit, bits);
+#else
+				unsigned bit = static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+				fn(word * 64 + bit);
+			}
+		}
+	}
+}
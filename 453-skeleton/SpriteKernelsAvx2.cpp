@@ -0,0 +1,201 @@
+// The AVX2 versions of the sprite kernels. The build compiles this file, and
+// only this file, with AVX2 and FMA enabled (and without contracting
+// multiplies and adds into FMAs on its own); SpriteKernels.cpp calls into it
+// only after checking the CPU has both. MSVC takes the intrinsics without
+// the flag.
+
+#include "SpriteKernelsSimd.h"
+
+#if SPRITE_KERNELS_SSE && (defined(__AVX2__) || defined(_MSC_VER))
+#define SPRITE_KERNELS_AVX2 1
+#include <immintrin.h>
+#endif
+
+
+using namespace SpriteKernels::detail;
+
+
+#if SPRITE_KERNELS_AVX2
+namespace {
+	// SinCos4() on eight angles, with fused multiply-adds
+	void SinCos8(__m256 angle, __m256& sine, __m256& cosine) {
+		const __m256 signMask = _mm256_set1_ps(-0.f);
+		__m256 x = _mm256_andnot_ps(signMask, angle);
+		__m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(fourOverPi)));
+		j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+		__m256 y = _mm256_cvtepi32_ps(j);
+		x = _mm256_fnmadd_ps(y, _mm256_set1_ps(reduce1), x);
+		x = _mm256_fnmadd_ps(y, _mm256_set1_ps(reduce2), x);
+		x = _mm256_fnmadd_ps(y, _mm256_set1_ps(reduce3), x);
+
+		__m256 z = _mm256_mul_ps(x, x);
+		__m256 cosPoly = _mm256_fmadd_ps(_mm256_set1_ps(cos1), z, _mm256_set1_ps(cos2));
+		cosPoly = _mm256_fmadd_ps(cosPoly, z, _mm256_set1_ps(cos3));
+		cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+		cosPoly = _mm256_add_ps(_mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, cosPoly), _mm256_set1_ps(1.f));
+		__m256 sinPoly = _mm256_fmadd_ps(_mm256_set1_ps(sin1), z, _mm256_set1_ps(sin2));
+		sinPoly = _mm256_fmadd_ps(sinPoly, z, _mm256_set1_ps(sin3));
+		sinPoly = _mm256_fmadd_ps(_mm256_mul_ps(sinPoly, z), x, x);
+
+		__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(2)));
+		__m256 sinSign = _mm256_xor_ps(_mm256_and_ps(angle, signMask), _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29)));
+		__m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+		sine = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, swap), sinSign);
+		cosine = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, swap), cosSign);
+	}
+}
+
+
+namespace SpriteKernels::detail {
+	const bool avx2Built = true;
+
+	size_t composeAvx2(const ComposeArgs& args) {
+		const size_t groups = args.count / 8 * 8;
+		const __m256 offset = _mm256_set1_ps(args.angleOffset);
+		const __m256 sizeX = _mm256_set1_ps(args.sizeX);
+		const __m256 sizeY = _mm256_set1_ps(args.sizeY);
+		for (size_t i = 0; i < groups; i += 8) {
+			__m256 s, c;
+			SinCos8(_mm256_add_ps(_mm256_loadu_ps(args.angle + i), offset), s, c);
+			__m256 scale = _mm256_loadu_ps(args.scale + i);
+			__m256 sx = _mm256_mul_ps(sizeX, scale);
+			__m256 sy = _mm256_mul_ps(sizeY, scale);
+			__m256 a = _mm256_mul_ps(c, sx);
+			__m256 b = _mm256_mul_ps(s, sx);
+			__m256 cc = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(s, sy));
+			__m256 d = _mm256_mul_ps(c, sy);
+			__m256 tx = _mm256_loadu_ps(args.x + i);
+			__m256 ty = _mm256_loadu_ps(args.y + i);
+
+			if (args.child) {
+				const float* l = args.child;
+				__m256 a2 = _mm256_fmadd_ps(a, _mm256_set1_ps(l[0]), _mm256_mul_ps(cc, _mm256_set1_ps(l[1])));
+				__m256 b2 = _mm256_fmadd_ps(b, _mm256_set1_ps(l[0]), _mm256_mul_ps(d, _mm256_set1_ps(l[1])));
+				__m256 c2 = _mm256_fmadd_ps(a, _mm256_set1_ps(l[2]), _mm256_mul_ps(cc, _mm256_set1_ps(l[3])));
+				__m256 d2 = _mm256_fmadd_ps(b, _mm256_set1_ps(l[2]), _mm256_mul_ps(d, _mm256_set1_ps(l[3])));
+				tx = _mm256_fmadd_ps(a, _mm256_set1_ps(l[4]), _mm256_fmadd_ps(cc, _mm256_set1_ps(l[5]), tx));
+				ty = _mm256_fmadd_ps(b, _mm256_set1_ps(l[4]), _mm256_fmadd_ps(d, _mm256_set1_ps(l[5]), ty));
+				a = a2;
+				b = b2;
+				cc = c2;
+				d = d2;
+			}
+
+			// As in composeSse(), except each register holds two groups of
+			// four, one per 128-bit half; the last step joins the halves
+			__m256d p0 = _mm256_castps_pd(_mm256_unpacklo_ps(a, b));
+			__m256d p1 = _mm256_castps_pd(_mm256_unpackhi_ps(a, b));
+			__m256d q0 = _mm256_castps_pd(_mm256_unpacklo_ps(cc, d));
+			__m256d q1 = _mm256_castps_pd(_mm256_unpackhi_ps(cc, d));
+			__m256d r0 = _mm256_castps_pd(_mm256_unpacklo_ps(tx, ty));
+			__m256d r1 = _mm256_castps_pd(_mm256_unpackhi_ps(tx, ty));
+			__m256d pq0 = _mm256_unpacklo_pd(p0, q0);
+			__m256d rp0 = _mm256_shuffle_pd(r0, p0, 0xA);
+			__m256d qr0 = _mm256_unpackhi_pd(q0, r0);
+			__m256d pq1 = _mm256_unpacklo_pd(p1, q1);
+			__m256d rp1 = _mm256_shuffle_pd(r1, p1, 0xA);
+			__m256d qr1 = _mm256_unpackhi_pd(q1, r1);
+			double* out = reinterpret_cast<double*>(args.out + 6 * i);
+			_mm256_storeu_pd(out + 0, _mm256_permute2f128_pd(pq0, rp0, 0x20));
+			_mm256_storeu_pd(out + 4, _mm256_permute2f128_pd(qr0, pq1, 0x20));
+			_mm256_storeu_pd(out + 8, _mm256_permute2f128_pd(rp1, qr1, 0x20));
+			_mm256_storeu_pd(out + 12, _mm256_permute2f128_pd(pq0, rp0, 0x31));
+			_mm256_storeu_pd(out + 16, _mm256_permute2f128_pd(qr0, pq1, 0x31));
+			_mm256_storeu_pd(out + 20, _mm256_permute2f128_pd(rp1, qr1, 0x31));
+		}
+		return groups;
+	}
+
+	size_t hitTestAvx2(const HitArgs& args) {
+		const size_t groups = args.count / 64 * 64;
+		const __m256 pointX = _mm256_set1_ps(args.pointX);
+		const __m256 pointY = _mm256_set1_ps(args.pointY);
+		const __m256 pointRadius = _mm256_set1_ps(args.pointRadius);
+		for (size_t word = 0; word * 64 < groups; word++) {
+			uint64_t bits = 0;
+			for (size_t lane = 0; lane < 64; lane += 8) {
+				size_t i = word * 64 + lane;
+				__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(args.x + i), pointX);
+				__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(args.y + i), pointY);
+				// Not fused, to match the other versions bit for bit
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+				__m256 range = args.radius ? _mm256_add_ps(pointRadius, _mm256_loadu_ps(args.radius + i)) : pointRadius;
+				__m256 hit = _mm256_cmp_ps(distance, _mm256_mul_ps(range, range), _CMP_LT_OQ);
+				if (args.ignore) {
+					__m256i ignore = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(args.ignore + i));
+					hit = _mm256_and_ps(hit, _mm256_castsi256_ps(_mm256_cmpeq_epi32(ignore, _mm256_setzero_si256())));
+				}
+				bits |= static_cast<uint64_t>(_mm256_movemask_ps(hit)) << lane;
+			}
+			args.hits[word] = bits;
+		}
+		return groups;
+	}
+
+	size_t hitTestFixedAvx2(const FixedHitArgs& args) {
+		const size_t groups = args.count / 64 * 64;
+		const __m256 one = _mm256_set1_ps(fixedOne);
+		const __m256i pointX = _mm256_set1_epi32(args.pointX);
+		const __m256i pointY = _mm256_set1_epi32(args.pointY);
+		const __m256i limit = _mm256_set1_epi32(fixedOffsetLimit);
+		const __m256i rangeSquared = _mm256_set1_epi32(args.rangeSquared);
+		// Unsigned minimum, as abs(-2^31) is still negative
+		auto offset = [&](const float* q, __m256i point) {
+			__m256i d = _mm256_sub_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(q), one)), point);
+			return _mm256_min_epu32(_mm256_abs_epi32(d), limit);
+		};
+		for (size_t word = 0; word * 64 < groups; word++) {
+			uint64_t bits = 0;
+			for (size_t lane = 0; lane < 64; lane += 8) {
+				size_t i = word * 64 + lane;
+				__m256i pairs = _mm256_or_si256(offset(args.x + i, pointX), _mm256_slli_epi32(offset(args.y + i, pointY), 16));
+				__m256i hit = _mm256_cmpgt_epi32(rangeSquared, _mm256_madd_epi16(pairs, pairs));
+				if (args.ignore) {
+					__m256i ignore = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(args.ignore + i));
+					hit = _mm256_and_si256(hit, _mm256_cmpeq_epi32(ignore, _mm256_setzero_si256()));
+				}
+				bits |= static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(hit))) << lane;
+			}
+			args.hits[word] = bits;
+		}
+		return groups;
+	}
+
+	size_t transformPointsAvx2(const float* transform, const float* x, const float* y, float* outX, float* outY, size_t count) {
+		const size_t groups = count / 8 * 8;
+		const __m256 t0 = _mm256_set1_ps(transform[0]);
+		const __m256 t1 = _mm256_set1_ps(transform[1]);
+		const __m256 t2 = _mm256_set1_ps(transform[2]);
+		const __m256 t3 = _mm256_set1_ps(transform[3]);
+		const __m256 t4 = _mm256_set1_ps(transform[4]);
+		const __m256 t5 = _mm256_set1_ps(transform[5]);
+		for (size_t i = 0; i < groups; i += 8) {
+			__m256 px = _mm256_loadu_ps(x + i);
+			__m256 py = _mm256_loadu_ps(y + i);
+			_mm256_storeu_ps(outX + i, _mm256_fmadd_ps(t0, px, _mm256_fmadd_ps(t2, py, t4)));
+			_mm256_storeu_ps(outY + i, _mm256_fmadd_ps(t1, px, _mm256_fmadd_ps(t3, py, t5)));
+		}
+		return groups;
+	}
+}
+#else
+namespace SpriteKernels::detail {
+	const bool avx2Built = false;
+
+	size_t composeAvx2(const ComposeArgs&) {
+		return 0;
+	}
+
+	size_t hitTestAvx2(const HitArgs&) {
+		return 0;
+	}
+
+	size_t hitTestFixedAvx2(const FixedHitArgs&) {
+		return 0;
+	}
+
+	size_t transformPointsAvx2(const float*, const float*, const float*, float*, float*, size_t) {
+		return 0;
+	}
+}
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Internals shared by SpriteKernels.cpp and SpriteKernelsAvx2.cpp.
+//
+// SpriteKernelsAvx2.cpp is compiled for AVX2, so it must not pull in inline
+// code that the rest of the program also uses: the linker could keep its AVX2
+// copy. Hence the plain pointers here instead of Affine2D.
+//
+// Hit tests can feed a simulation, so every version must give the same bits:
+// they compute dx * dx + dy * dy and (pointRadius + radius)^2 with separate
+// multiplies and adds, never fused ones.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPRITE_KERNELS_SSE 1
+#endif
+
+
+namespace SpriteKernels::detail {
+	// Sine and cosine as in Cephes' sinf/cosf: the angle is reduced by a
+	// multiple of PI/4, subtracted in three parts so the reduction stays
+	// exact, then one of two polynomials is evaluated and the octant decides
+	// which goes where and with what sign. Good to about 1e-7 while
+	// |angle| < 8192.
+	const float fourOverPi = 1.27323954473516f;
+	const float reduce1 = 0.78515625f;
+	const float reduce2 = 2.4187564849853515625e-4f;
+	const float reduce3 = 3.77489497744594108e-8f;
+	const float sin1 = -1.9515295891e-4f;
+	const float sin2 = 8.3321608736e-3f;
+	const float sin3 = -1.6666654611e-1f;
+	const float cos1 = 2.443315711809948e-5f;
+	const float cos2 = -1.388731625493765e-3f;
+	const float cos3 = 4.166664568298827e-2f;
+
+	struct ComposeArgs {
+		const float* x;
+		const float* y;
+		const float* angle;
+		const float* scale;
+		size_t count;
+		float angleOffset;
+		float sizeX;
+		float sizeY;
+		const float* child;	// 6 floats in Affine2D order, or null
+		float* out;			// 6 floats per sprite, in Affine2D order
+	};
+
+	struct HitArgs {
+		float pointX;
+		float pointY;
+		float pointRadius;
+		const float* x;
+		const float* y;
+		const float* radius;		// or null
+		const uint32_t* ignore;		// or null
+		size_t count;
+		uint64_t* hits;
+	};
+
+	// For hitTestFixed(). Offsets are clamped to 15 bits, so that each
+	// square and their sum fit in 32 bits and the SIMD versions can square
+	// and add a dx, dy pair in 16-bit lanes with one multiply-add.
+	const float fixedOne = 65536.f;
+	const int32_t fixedOffsetLimit = 0x7FFF;
+
+	struct FixedHitArgs {
+		int32_t pointX;
+		int32_t pointY;
+		int32_t rangeSquared;
+		const float* x;
+		const float* y;
+		const uint32_t* ignore;		// or null
+		size_t count;
+		uint64_t* hits;
+	};
+
+	// The SIMD versions only handle whole groups (of 4 or 8, or 64 for hit
+	// tests) and return how many sprites or points they did; the scalar code
+	// does the rest
+	size_t composeSse(const ComposeArgs& args);
+	size_t hitTestSse(const HitArgs& args);
+	size_t hitTestFixedSse(const FixedHitArgs& args);
+	size_t transformPointsSse(const float* transform, const float* x, const float* y, float* outX, float* outY, size_t count);
+
+	// False when the build has no AVX2 kernels (not x86, or no AVX2 flags)
+	extern const bool avx2Built;
+	size_t composeAvx2(const ComposeArgs& args);
+	size_t hitTestAvx2(const HitArgs& args);
+	size_t hitTestFixedAvx2(const FixedHitArgs& args);
+	size_t transformPointsAvx2(const float* transform, const float* x, const float* y, float* outX, float* outY, size_t count);
+}
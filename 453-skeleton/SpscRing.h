@@ -0,0 +1,76 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A bounded, lock-free single-producer single-consumer ring buffer.
+//
+// With exactly one producer and one consumer thread the ring needs no locks:
+// each side owns one index and only reads the other's. Used for the input
+// event queue and for the async logger's per-thread buffers.
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstddef>
+
+
+// Single-producer single-consumer ring buffer. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscRing {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+	// Producer side. Returns false (dropping the item) if the ring is full.
+	bool push(const T& item) {
+		size_t tail = writeIndex.load(std::memory_order_relaxed);
+		if (full(tail)) {
+			return false;
+		}
+		items[tail & (Capacity - 1)] = item;
+		writeIndex.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Producer side, for filling an item in place: claim() returns the next free
+	// slot (nullptr if full), and publish() hands it to the consumer.
+	T* claim() {
+		size_t tail = writeIndex.load(std::memory_order_relaxed);
+		if (full(tail)) {
+			return nullptr;
+		}
+		return &items[tail & (Capacity - 1)];
+	}
+
+	void publish() {
+		writeIndex.store(writeIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Consumer side. front() returns nullptr when empty; the pointer is valid until pop().
+	const T* front() const {
+		size_t head = readIndex.load(std::memory_order_relaxed);
+		if (head == writeIndex.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		return &items[head & (Capacity - 1)];
+	}
+
+	void pop() {
+		readIndex.store(readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	bool empty() const { return front() == nullptr; }
+
+private:
+	// Indices on separate cache lines so producer and consumer don't false-share
+	alignas(64) std::atomic<size_t> writeIndex{ 0 };
+	size_t cachedReadIndex = 0; // producer's last look at readIndex
+	alignas(64) std::atomic<size_t> readIndex{ 0 };
+	T items[Capacity];
+
+	// Only touches the consumer's cache line when the ring looks full
+	bool full(size_t tail) {
+		if (tail - cachedReadIndex < Capacity) {
+			return false;
+		}
+		cachedReadIndex = readIndex.load(std::memory_order_acquire);
+		return tail - cachedReadIndex == Capacity;
+	}
+};
@@ -45,6 +45,8 @@ Texture::Texture(std::string path, GLint interpolation)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, interpolation);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, interpolation);
 
+		alphaMask = AlphaMask::fromPixels(data, width, height, numComponents);
+
 		// Clean up
 		unbind();
 		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "AlphaMask.h"
 #include "GLHandles.h"
+#include "RenderStats.h"
 #include <GL/glew.h>
 #include <string>
 
@@ -25,9 +27,11 @@ public:
 	// Although uint (i.e. uvec2) might make more sense here, went with int (i.e. ivec2) under
 	// the assumption that most students will want to work with ints, not uints, in main.cpp
 	glm::ivec2 getDimensions() const { return glm::uvec2(width, height); }
+	// Which texels are drawn, for hit tests that match what's on screen
+	const AlphaMask& getAlphaMask() const { return alphaMask; }
 
-	void bind() { glBindTexture(GL_TEXTURE_2D, textureID); }
-	void unbind() { glBindTexture(GL_TEXTURE_2D, textureID); }
+	void bind() { glBindTexture(GL_TEXTURE_2D, textureID); RenderStats::countStateChange(); }
+	void unbind() { glBindTexture(GL_TEXTURE_2D, textureID); RenderStats::countStateChange(); }
 
 private:
 	TextureHandle textureID;
@@ -40,6 +44,8 @@ private:
 	int width;
 	int height;
 
+	AlphaMask alphaMask;
+
 
 
 };
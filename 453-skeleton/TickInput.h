@@ -0,0 +1,14 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+
+// Everything the simulation reads from the player during one tick.
+// Recordings store a stream of these, so it has to stay plain data.
+struct TickInput {
+	bool moveForward = false;
+	bool moveBack = false;
+	bool turning = false;
+	bool reset = false;
+	glm::vec2 target = glm::vec2(0.f); // where the ship turns towards, in OpenGL coordinates
+};
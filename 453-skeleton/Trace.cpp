@@ -0,0 +1,197 @@
+#include "Trace.h"
+
+#include "Log.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace Trace::detail {
+	std::atomic<bool> recording{ false };
+}
+
+
+namespace {
+	struct Event {
+		const char* name;
+		uint64_t begin;
+		uint64_t end;
+		uint32_t allocations;	// made by the zone's thread while it was open
+		uint64_t allocatedBytes;
+	};
+
+	// Events of one thread, in fixed-size chunks so dump() can read them while
+	// the thread keeps appending. `count` is published after each event.
+	struct ThreadBuffer {
+		static const size_t chunkSize = 16 * 1024;
+		static const size_t maxChunks = 1024;
+
+		std::atomic<Event*> chunks[maxChunks] = {};
+		std::atomic<size_t> count{ 0 };
+		uint32_t id = 0;
+
+		std::mutex nameMutex;
+		std::string name;
+
+		~ThreadBuffer() {
+			for (std::atomic<Event*>& chunk : chunks) {
+				delete[] chunk.load();
+			}
+		}
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+		// Reference point for turning timestamps into microseconds
+		uint64_t startTimestamp = 0;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	Registry& registry() {
+		static Registry instance;
+		return instance;
+	}
+
+	// Owned by the registry, so zones from threads that have exited still get dumped
+	thread_local ThreadBuffer* tlsBuffer = nullptr;
+	// Where this thread's next event goes, and where its current chunk ends
+	thread_local Event* tlsNext = nullptr;
+	thread_local Event* tlsChunkEnd = nullptr;
+
+	ThreadBuffer& threadBuffer() {
+		if (!tlsBuffer) {
+			Registry& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.buffers.push_back(std::make_unique<ThreadBuffer>());
+			tlsBuffer = r.buffers.back().get();
+			tlsBuffer->id = static_cast<uint32_t>(r.buffers.size());
+		}
+		return *tlsBuffer;
+	}
+
+	void writeEscaped(std::FILE* file, const std::string& text) {
+		for (char c : text) {
+			if (c == '"' || c == '\\') std::fputc('\\', file);
+			std::fputc(c, file);
+		}
+	}
+}
+
+
+namespace Trace {
+	void start() {
+#if TRACE_ENABLED
+		Registry& r = registry();
+		{
+			std::lock_guard<std::mutex> lock(r.mutex);
+			if (r.startTimestamp == 0) {
+				r.startTime = std::chrono::steady_clock::now();
+				r.startTimestamp = detail::timestamp();
+			}
+		}
+		detail::recording = true;
+		Log::info("TRACE recording");
+#else
+		Log::warn("TRACE zones are compiled out (configure with -DTRACE_ENABLED=ON)");
+#endif
+	}
+
+	void stop() {
+		detail::recording = false;
+	}
+
+	bool isRecording() {
+		return detail::recording.load(std::memory_order_relaxed);
+	}
+
+	void setThreadName(const std::string& name) {
+		ThreadBuffer& buffer = threadBuffer();
+		std::lock_guard<std::mutex> lock(buffer.nameMutex);
+		buffer.name = name;
+	}
+
+	bool dump(const std::string& path) {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		if (r.startTimestamp == 0) {
+			Log::warn("TRACE nothing recorded, not writing {}", path);
+			return false;
+		}
+
+		std::FILE* file = std::fopen(path.c_str(), "w");
+		if (!file) {
+			Log::error("TRACE couldn't create {}", path);
+			return false;
+		}
+
+		// Timestamps per microsecond, measured over the whole recording
+		double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - r.startTime).count();
+		uint64_t ticks = detail::timestamp() - r.startTimestamp;
+		double ticksPerMicrosecond = elapsed > 0.0 ? ticks / elapsed : 1.0;
+#ifndef TRACE_RDTSC
+		ticksPerMicrosecond = 1000.0;
+#endif
+
+		size_t events = 0;
+		std::fputs("{\"traceEvents\":[\n", file);
+		bool first = true;
+		for (const std::unique_ptr<ThreadBuffer>& buffer : r.buffers) {
+			{
+				std::lock_guard<std::mutex> nameLock(buffer->nameMutex);
+				if (!buffer->name.empty()) {
+					std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", buffer->id);
+					writeEscaped(file, buffer->name);
+					std::fputs("\"}}", file);
+					first = false;
+				}
+			}
+
+			size_t count = buffer->count.load(std::memory_order_acquire);
+			for (size_t i = 0; i < count; i++) {
+				const Event& e = buffer->chunks[i / ThreadBuffer::chunkSize].load(std::memory_order_acquire)[i % ThreadBuffer::chunkSize];
+				// Zones that started before the first start() are clamped to it
+				double begin = e.begin > r.startTimestamp ? (e.begin - r.startTimestamp) / ticksPerMicrosecond : 0.0;
+				double duration = e.end > e.begin ? (e.end - e.begin) / ticksPerMicrosecond : 0.0;
+				std::fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+				writeEscaped(file, e.name);
+				std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", buffer->id, begin, duration);
+				if (e.allocations) {
+					std::fprintf(file, ",\"args\":{\"allocations\":%u,\"bytes\":%llu}", e.allocations, static_cast<unsigned long long>(e.allocatedBytes));
+				}
+				std::fputc('}', file);
+				first = false;
+			}
+			events += count;
+		}
+		std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+		std::fclose(file);
+
+		Log::info("TRACE wrote {} zones to {}", events, path);
+		return true;
+	}
+}
+
+
+namespace Trace::detail {
+	void record(const char* name, uint64_t begin, uint64_t end, const AllocTracker::Counts& allocations) {
+		if (tlsNext == tlsChunkEnd) {
+			ThreadBuffer& buffer = threadBuffer();
+			size_t chunk = buffer.count.load(std::memory_order_relaxed) / ThreadBuffer::chunkSize;
+			if (chunk >= ThreadBuffer::maxChunks) {
+				return; // full; the trace simply ends here for this thread
+			}
+			// Touch the pages now rather than one fault at a time inside zones
+			Event* events = new Event[ThreadBuffer::chunkSize]();
+			buffer.chunks[chunk].store(events, std::memory_order_release);
+			tlsNext = events;
+			tlsChunkEnd = events + ThreadBuffer::chunkSize;
+		}
+		*tlsNext++ = { name, begin, end, static_cast<uint32_t>(allocations.allocations), allocations.bytes };
+		// Only this thread writes count, so no read-modify-write is needed
+		tlsBuffer->count.store(tlsBuffer->count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A small frame tracer.
+//
+// TRACE_ZONE("name") times the rest of the enclosing scope. Zones land in a
+// buffer owned by the recording thread, so recording takes no locks; dump()
+// writes every zone recorded so far as Chrome trace JSON, which loads in
+// chrome://tracing and https://ui.perfetto.dev.
+//
+// Example:
+//   void Game::tick(const TickInput& input) {
+//       TRACE_ZONE("Game::tick");
+//       ...
+//   }
+//
+// Each zone also notes how many heap allocations its thread made inside it
+// (see AllocTracker.h); they show up as the zone's arguments in the viewer.
+//
+// Zones only record between Trace::start() and Trace::stop(); otherwise a zone
+// costs one relaxed load. Configuring with -DTRACE_ENABLED=OFF compiles every
+// TRACE_ZONE out. Zone names must be string literals.
+//------------------------------------------------------------------------------
+
+#include "AllocTracker.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TRACE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_RDTSC 1
+#endif
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+
+namespace Trace {
+	void start();
+	void stop();
+	bool isRecording();
+
+	// Writes every zone recorded so far; recording carries on
+	bool dump(const std::string& path);
+
+	// Shown as the thread's track name in the trace viewer
+	void setThreadName(const std::string& name);
+
+
+	namespace detail {
+		extern std::atomic<bool> recording;
+
+		void record(const char* name, uint64_t begin, uint64_t end, const AllocTracker::Counts& allocations);
+
+		// CPU timestamp counter where there is one (converted to time at dump),
+		// the steady clock in nanoseconds everywhere else
+		inline uint64_t timestamp() {
+#ifdef TRACE_RDTSC
+			return __rdtsc();
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+	}
+
+
+	class Zone {
+
+	public:
+		explicit Zone(const char* name)
+			: name(detail::recording.load(std::memory_order_relaxed) ? name : nullptr)
+		{
+			if (this->name) {
+				allocations = AllocTracker::thread();
+				begin = detail::timestamp();
+			}
+		}
+
+		~Zone() {
+			if (name) {
+				uint64_t end = detail::timestamp();
+				detail::record(name, begin, end, AllocTracker::thread() - allocations);
+			}
+		}
+
+		Zone(const Zone&) = delete;
+		Zone operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		uint64_t begin = 0;
+		AllocTracker::Counts allocations;
+	};
+}
+
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#define TRACE_ZONE(name) do {} while (0)
+#endif
@@ -0,0 +1,75 @@
+#include "Transforms.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+Affine2D MakeRotationMatrix(float theta) {
+	return Affine2D::rotate(-theta);
+}
+
+Affine2D MakeTranslationMatrix(float distance, float theta) {
+	return Affine2D::translate(cos(theta) * distance, sin(theta) * distance);
+}
+
+Affine2D MakeTranslationMatrixXY(float x, float y) {
+	return Affine2D::translate(x, y);
+}
+
+Affine2D MakeScaleMatrix(float scale) {
+	return Affine2D::scale(scale);
+}
+
+Affine2D MakeScaleMatrixXY(float x, float y) {
+	return Affine2D::scale(x, y);
+}
+
+Affine2D Reset(glm::vec2 pos, float direction) {
+	return Affine2D::translate(direction * pos.x, direction * pos.y);
+}
+
+Affine2D MakeChildrenMatrix(glm::vec2 parentPos, float theta, glm::vec2 childPos, int numOfChildren) {
+	Affine2D matrix = Reset(childPos, 1) * MakeRotationMatrix(theta) * Reset(childPos, -1);
+	float x = parentPos.x - childPos.x + cos(theta + PI)*numOfChildren * 0.15f;
+	float y = parentPos.y - childPos.y + sin(theta + PI) * numOfChildren * 0.15f;
+	matrix = MakeTranslationMatrixXY(x, y) * matrix;
+	return matrix;
+}
+
+
+bool Close(glm::vec2 pos1, glm::vec2 pos2) {
+	float x = pos2.x - pos1.x;
+	float y = pos2.y - pos1.y;
+	return sqrt(x * x + y * y) < 0.1f;
+}
+
+float FastAtan2(float y, float x) {
+	// Abramowitz and Stegun's polynomial 4.4.47 for atan on [0, 1], applied to
+	// the smaller of |x| and |y| over the larger; the rest of the circle
+	// follows by symmetry
+	float absX = std::fabs(x);
+	float absY = std::fabs(y);
+	float larger = std::max(absX, absY);
+	float a = std::min(absX, absY) / (larger > 0.f ? larger : 1.f);
+	float s = a * a;
+	float r = a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+	r = absY > absX ? PI / 2 - r : r;
+	r = x < 0.f ? PI - r : r;
+	return y < 0.f ? -r : r;
+}
+
+bool Goleft(float theta, float angle) {
+	float distanceNeg;
+	float distancePos;
+	if (angle > theta) {
+		distancePos = angle - theta;
+		distanceNeg = theta - (angle - 2 * PI);
+	}
+	else {
+		distanceNeg = theta - angle;
+		distancePos = (angle + 2 * PI) - theta;
+	}
+
+	if (distancePos <= distanceNeg) return true;
+	else return false;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// 2D transformation helpers shared by the simulation and the renderer.
+//
+// The matrices are Affine2D (see Affine2D.h); the renderer converts them to
+// mat4 only when uploading. Note that MakeRotationMatrix(theta) rotates
+// *clockwise* by theta.
+//------------------------------------------------------------------------------
+
+#include "Affine2D.h"
+
+#include <glm/glm.hpp>
+
+
+const float PI = 3.14159265359f;
+
+Affine2D MakeRotationMatrix(float theta);
+Affine2D MakeTranslationMatrix(float distance, float theta);
+Affine2D MakeTranslationMatrixXY(float x, float y);
+Affine2D MakeScaleMatrix(float scale);
+Affine2D MakeScaleMatrixXY(float x, float y);
+
+// Translation by pos (direction 1) or back by -pos (direction -1), used to
+// rotate or scale about pos: Reset(pos, 1) * M * Reset(pos, -1)
+Affine2D Reset(glm::vec2 pos, float direction);
+
+// Places a child numOfChildren spacings behind its parent, rotated by theta
+Affine2D MakeChildrenMatrix(glm::vec2 parentPos, float theta, glm::vec2 childPos, int numOfChildren);
+
+// True if the two points are within pickup/hit range of each other. One pair
+// at a time; the game tests whole arrays with SpriteKernels::hitTest.
+bool Close(glm::vec2 pos1, glm::vec2 pos2);
+
+// atan2(y, x) to within 2e-5 radians, without branches or library calls, so
+// loops over it vectorize. Returns 0 for (0, 0).
+float FastAtan2(float y, float x);
+
+// True if turning counterclockwise from theta reaches angle sooner than turning
+// clockwise. Both angles in [0, 2PI).
+bool Goleft(float theta, float angle);
@@ -3,15 +3,19 @@
 #include <utility>
 
 
-VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
+VertexBuffer::VertexBuffer(const VertexLayout& layout)
 	: bufferID{}
 {
 	bind();
-	glVertexAttribPointer(index, size, dataType, GL_FALSE, 0, (void*)0);
-	glEnableVertexAttribArray(index);
+	layout.apply();
 }
 
 
+VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
+	: VertexBuffer(VertexLayout().add(index, size, dataType, 0))
+{}
+
+
 void VertexBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
 	bind();
 	glBufferData(GL_ARRAY_BUFFER, size, data, usage);
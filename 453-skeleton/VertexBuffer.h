@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "VertexLayout.h"
 
 #include <GL/glew.h>
 
@@ -8,6 +9,10 @@
 class VertexBuffer {
 
 public:
+	// Sets up the bound vertex array to read the layout's attributes from
+	// this buffer
+	explicit VertexBuffer(const VertexLayout& layout);
+	// One tightly packed attribute per vertex
 	VertexBuffer(GLuint index, GLint size, GLenum dataType);
 
 	// Because we're using the VertexBufferHandle to do RAII for the buffer for us
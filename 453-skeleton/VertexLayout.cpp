@@ -0,0 +1,10 @@
+#include "VertexLayout.h"
+
+
+void VertexLayout::apply() const {
+	for (const VertexAttribute& attribute : attributes) {
+		glVertexAttribPointer(attribute.location, attribute.components, attribute.type, attribute.normalized, stride, (void*)attribute.offset);
+		glEnableVertexAttribArray(attribute.location);
+		glVertexAttribDivisor(attribute.location, divisor);
+	}
+}
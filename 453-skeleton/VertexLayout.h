@@ -0,0 +1,61 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// How the bytes of one vertex buffer feed a shader's attributes: where each
+// attribute sits within an element, how far apart elements are (the stride),
+// and whether elements advance per vertex or per instance (the divisor).
+//
+// Several attributes sharing one buffer (interleaved) keep everything a
+// vertex needs in one fetch; a divisor of 1 gives every instance of an
+// instanced draw its own element.
+//
+// Example:
+//   VertexLayout layout(sizeof(Vertex));
+//   layout.add(0, 3, GL_FLOAT, offsetof(Vertex, pos))
+//         .add(1, 2, GL_FLOAT, offsetof(Vertex, texCoord));
+//   VertexBuffer buffer(layout);
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+
+struct VertexAttribute {
+	GLuint location;		// layout (location = ...) in the shader
+	GLint components;		// 1 to 4
+	GLenum type;			// GL_FLOAT, or an integer type read as floats
+	GLboolean normalized;	// integers map to [0, 1] or [-1, 1]
+	size_t offset;			// bytes from the start of an element
+};
+
+
+class VertexLayout {
+
+public:
+	// A stride of 0 means elements are exactly as big as their attributes;
+	// a divisor of 0 advances per vertex, n once every n instances
+	explicit VertexLayout(GLsizei stride = 0, GLuint divisor = 0)
+		: stride(stride), divisor(divisor)
+	{}
+
+	// Public interface
+	VertexLayout& add(GLuint location, GLint components, GLenum type, size_t offset, GLboolean normalized = GL_FALSE) {
+		attributes.push_back(VertexAttribute{ location, components, type, normalized, offset });
+		return *this;
+	}
+
+	GLsizei getStride() const { return stride; }
+	GLuint getDivisor() const { return divisor; }
+	const std::vector<VertexAttribute>& getAttributes() const { return attributes; }
+
+	// Points and enables the attributes of the bound vertex array at the
+	// buffer bound to GL_ARRAY_BUFFER
+	void apply() const;
+
+private:
+	GLsizei stride;
+	GLuint divisor;
+	std::vector<VertexAttribute> attributes;
+};
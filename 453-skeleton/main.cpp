@@ -1,15 +1,38 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
 
+#include <argh.h>
+
+#include "Affine2D.h"
+#include "AllocTracker.h"
+#include "AlphaMask.h"
+#include "Bench.h"
+#include "Game.h"
 #include "Geometry.h"
 #include "GLDebug.h"
+#include "GpuTimer.h"
+#include "InputQueue.h"
+#include "InputRecording.h"
+#include "JobSystem.h"
 #include "Log.h"
+#include "PerfPanel.h"
+#include "RenderStats.h"
+#include "Rollback.h"
 #include "ShaderProgram.h"
 #include "Shader.h"
+#include "SpriteKernels.h"
 #include "Texture.h"
+#include "TickInput.h"
+#include "Trace.h"
+#include "VertexLayout.h"
 #include "Window.h"
 
 #include "imgui/imgui.h"
@@ -19,210 +42,153 @@
 
 
 
-// An example struct for Game Objects.
-// You are encouraged to customize this as you see fit.
-int score = 0;
-struct GameObject {
-	// Struct's constructor deals with the texture.
-	// Also sets default position, theta, scale, and transformationMatrix
-	GameObject(std::string texturePath, GLenum textureInterpolation) :
+// Each instance of a sprite is drawn with its own Affine2D, read straight
+// from the array of transforms by test.vert
+VertexLayout SpriteInstanceLayout() {
+	VertexLayout layout(sizeof(Affine2D), 1);
+	layout.add(2, 2, GL_FLOAT, offsetof(Affine2D, axisX))
+		.add(3, 2, GL_FLOAT, offsetof(Affine2D, axisY))
+		.add(4, 2, GL_FLOAT, offsetof(Affine2D, translation));
+	return layout;
+}
+
+// Render resources for one kind of sprite, shared by every entity of that kind.
+// Where things are lives in the GameState, not here.
+struct Sprite {
+	// Draws `quad` as is, or with `trim` only the part of it around the
+	// texture's drawn texels (see TrimmedQuad)
+	Sprite(std::string texturePath, GLenum textureInterpolation, CPU_Geometry quad, bool trim) :
 		texture(texturePath, textureInterpolation),
-		position(0.0f, 0.0f, 0.0f, 1.f),
-		theta(0),
-		scale(1),
-		transformationMatrix(1.0f), // This constructor sets it as the identity matrix
-		active(true)
-	{}
-
-	bool active = true;
+		cgeom(trim ? TrimmedQuad(texture.getAlphaMask()) : std::move(quad)),
+		ggeom(SpriteInstanceLayout())
+	{
+		ggeom.upload(cgeom);
+	}
+
+	// The texture comes first: the trimmed geometry is built from its mask
+	Texture texture;
 	CPU_Geometry cgeom;
 	GPU_Geometry ggeom;
-	Texture texture;
-
-	glm::vec4 position;
-	glm::vec4 defaultPosition;
-	glm::mat4 defaultTransformationMatrix;
-	std::vector<std::shared_ptr<GameObject>> children;
-	std::shared_ptr<GameObject> parent;
-	std::vector<glm::mat4> transformations;
-	float theta; // Object's rotation
-	// Alternatively, you could represent rotation via a normalized heading vec:
-	// glm::vec3 heading;
-	float scale; // Or, alternatively, a glm::vec2 scale;
-	glm::mat4 transformationMatrix;
 };
 
-const float PI = 3.14159265359;
-
-glm::mat4 MakeRotationMatrix(float theta) {
-	glm::mat4 rotation(
-		cos(theta), -sin(theta), 0.f, 0.f,
-		sin(theta), cos(theta), 0.f, 0.f,
-		0.f, 0.f, 1.f, 0.f,
-		0.f, 0.f, 0.f, 1.f
-	);
-	return rotation;
-}
-
-glm::mat4 MakeTranslationMatrix(float distance, float theta) {
-	glm::mat4 translation(
-		1.f, 0.f, 0.f, 0.f,
-		0.f, 1.f, 0.f, 0.f,
-		0.f, 0.f, 1.f, 0.f,
-		cos(theta) *distance, sin(theta) *distance, 0.f, 1.f
-	);
-	return translation;
-}
-
-glm::mat4 MakeTranslationMatrixXY(float x, float y) {
-	glm::mat4 translation(
-		1.f, 0.f, 0.f, 0.f,
-		0.f, 1.f, 0.f, 0.f,
-		0.f, 0.f, 1.f, 0.f,
-		x, y, 0.f, 1.f
-	);
-	return translation;
-}
-
-glm::mat4 MakeScaleMatrix(float scale) {
-	glm::mat4 scaling(
-		scale, 0.f, 0.f, 0.f,
-		0.f, scale, 0.f, 0.f,
-		0.f, 0.f, 1.f, 0.f,
-		0.f, 0.f, 0.f, 1.f
-	);
-	return scaling;
-}
-
-glm::mat4 MakeScaleMatrixXY(float x, float y) {
-	glm::mat4 scaling(
-		x, 0.f, 0.f, 0.f,
-		0.f, y, 0.f, 0.f,
-		0.f, 0.f, 1.f, 0.f,
-		0.f, 0.f, 0.f, 1.f
-	);
-	return scaling;
-}
-
-
-
-glm::mat4 Reset(glm::vec4 pos, float direction) {
-	glm::mat4 translation(
-		1.f, 0.f, 0.f, 0.f,
-		0.f, 1.f, 0.f, 0.f,
-		0.f, 0.f, 1.f, 0.f,
-		direction * pos.x, direction * pos.y, 0.f, 1.f
-	);
-	return translation;
-}
+// Folds raw input events into per-tick input. Held keys carry over between ticks,
+// and a press that is released again before the tick ends still counts for that tick.
+class InputState {
 
-glm::mat4 MakeChildrenMatrix(glm::vec4 parentPos, float theta, glm::vec4 childPos, int numOfChildren) {
-	glm::mat4 matrix = Reset(childPos, 1) * MakeRotationMatrix(theta) * Reset(childPos, -1);
-	float x = parentPos.x - childPos.x + cos(theta + PI)*numOfChildren * 0.15f;
-	float y = parentPos.y - childPos.y + sin(theta + PI) * numOfChildren * 0.15f;
-	matrix = MakeTranslationMatrixXY(x, y) * matrix;
-	return matrix;
-}
-
-
-bool Close(glm::vec4 pos1, glm::vec4 pos2) {
-	float x = pos2.x - pos1.x;
-	float y = pos2.y - pos1.y;
-	return sqrt(x * x + y * y) < 0.1f;
-}
+public:
+	void Apply(const InputEvent& e) {
+		bool pressed = e.action == GLFW_PRESS || e.action == GLFW_REPEAT;
+		if (e.type == InputEventType::Key) {
+			if (e.code == GLFW_KEY_W) {
+				held.moveForward = pressed;
+				tapped.moveForward |= pressed;
+			}
+			else if (e.code == GLFW_KEY_S) {
+				held.moveBack = pressed;
+				tapped.moveBack |= pressed;
+			}
+			else if (e.code == GLFW_KEY_SPACE && e.action == GLFW_PRESS) {
+				tapped.reset = true;
+			}
+			else if (e.code == GLFW_KEY_BACKSPACE) {
+				rewinding = pressed;
+			}
+		}
+		else if (e.type == InputEventType::MouseButton && e.code == GLFW_MOUSE_BUTTON_LEFT) {
+			held.turning = pressed;
+			tapped.turning |= pressed;
+			held.target = cursor;
+		}
+		else if (e.type == InputEventType::CursorPos) {
+			cursor = glm::vec2(e.x, e.y);
+			if (held.turning) {
+				held.target = cursor;
+			}
+		}
+	}
 
-bool Goleft(float theta, float angle) {
-	float distanceNeg;
-	float distancePos;
-	if (angle > theta) {
-		distancePos = angle - theta;
-		distanceNeg = theta - (angle - 2 * PI);
+	// Input for the tick that just ended; clears the per-tick presses
+	TickInput TakeTick() {
+		TickInput input = held;
+		input.moveForward |= tapped.moveForward;
+		input.moveBack |= tapped.moveBack;
+		input.turning |= tapped.turning;
+		input.reset = tapped.reset;
+		tapped = TickInput();
+		return input;
 	}
-	else {
-		distanceNeg = theta - angle;
-		distancePos = (angle + 2 * PI) - theta;
+
+	// Debug time travel: while held, ticks run backwards instead of forwards
+	bool IsRewinding() const {
+		return rewinding;
 	}
 
-	if (distancePos <= distanceNeg) return true;
-	else return false;
-}
+private:
+	TickInput held;
+	TickInput tapped;
+	bool rewinding = false;
+	glm::vec2 cursor = glm::vec2(0.f);
+};
 
 // EXAMPLE CALLBACKS
+// The callbacks only record timestamped events; the simulation drains them
+// from the input queue at tick boundaries.
 class MyCallbacks : public CallbackInterface {
 
 public:
-	MyCallbacks(ShaderProgram& shader, int width, int height) :
+	MyCallbacks(ShaderProgram& shader, PerfPanel& perfPanel, int width, int height, std::string tracePath) :
 		screenDim(width,height),
-		shader(shader) {
+		shader(shader),
+		perfPanel(perfPanel),
+		tracePath(std::move(tracePath)) {
 		xDiv = width / 2.0f;
 		yDiv = height / 2.0f;
 	}
 
 	virtual void keyCallback(int key, int scancode, int action, int mods) {
-		if(action == GLFW_PRESS) {
-			if (key == GLFW_KEY_R) {
-				shader.recompile();
-			}
-			else if (key == GLFW_KEY_W) {
-				moveForward = true;
-			}
-			else if (key == GLFW_KEY_S) {
-				moveBack = true;
-			}
-			else if (key == GLFW_KEY_SPACE) {
-				reset = true;
-			}
+		if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+			shader.recompile();
+			return;
 		}
-		else if (action == GLFW_RELEASE) {
-			if (key == GLFW_KEY_W) {
-			moveForward = false;
+		// F9 starts tracing; after that, each press writes what's been recorded so far
+		if (key == GLFW_KEY_F9 && action == GLFW_PRESS) {
+			if (Trace::isRecording()) {
+				Trace::dump(tracePath);
 			}
-			else if (key == GLFW_KEY_S) {
-			moveBack = false;
+			else {
+				Trace::start();
 			}
+			return;
 		}
-	}
-
-	virtual void mouseButtonCallback(int button, int action, int mods) {
-		if (button == GLFW_MOUSE_BUTTON_LEFT) {
-			if (action == GLFW_PRESS || action == GLFW_REPEAT) {
-				GLmouse();
-				leftPressed = true;
-			}
-			else if (action == GLFW_RELEASE) {
-				leftPressed = false;
-			}
+		if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+			perfPanel.toggle();
+			return;
 		}
+		InputEvent e;
+		e.type = InputEventType::Key;
+		e.code = key;
+		e.action = action;
+		Push(e);
 	}
 
-	void GLmouse() {
-		clickPos = glm::vec2(mousePos.x / xDiv - 1, mousePos.y / -yDiv + 1);
+	virtual void mouseButtonCallback(int button, int action, int mods) {
+		InputEvent e;
+		e.type = InputEventType::MouseButton;
+		e.code = button;
+		e.action = action;
+		Push(e);
 	}
 
 	virtual void cursorPosCallback(double xpos, double ypos) {
-		mousePos.x = xpos;
-		mousePos.y = ypos;
-
-	}
-
-	glm::vec2 GetClickPosition() {
-		return clickPos;
+		InputEvent e;
+		e.type = InputEventType::CursorPos;
+		e.x = xpos / xDiv - 1;
+		e.y = ypos / -yDiv + 1;
+		Push(e);
 	}
 
-	bool GetLeftPressed() {
-		return leftPressed;
-	}
-	bool GetMoveForward() {
-		return moveForward;
-	}
-	bool GetMoveBack() {
-		return moveBack;
-	}
-	bool GetReset() {
-		return reset;
-	}
-	void ResetDone() {
-		reset = false;
+	InputQueue& GetInputQueue() {
+		return inputQueue;
 	}
 
 
@@ -230,79 +196,351 @@ private:
 	float xDiv;
 	float yDiv;
 	glm::vec2 screenDim;
-	glm::vec2 mousePos = glm::vec2(1.0f);
-	glm::vec2 clickPos;
 	ShaderProgram& shader;
-	bool leftPressed = false;
-	bool moveForward = false;
-	bool moveBack = false;
-	bool reset = false;
+	PerfPanel& perfPanel;
+	std::string tracePath;
+	InputQueue inputQueue;
+
+	void Push(InputEvent e) {
+		e.time = glfwGetTime();
+		if (!inputQueue.push(e)) {
+			LOG_WARN("INPUT queue full, dropping event");
+		}
+	}
 };
 
 
-CPU_Geometry shipGeom(float width, float height) {
-	float halfWidth = width / 2.0f;
-	float halfHeight = height / 2.0f;
-	CPU_Geometry retGeom;
-	
-	retGeom.verts.push_back(glm::vec3(-1.f, 1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(-1.f, -1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(1.f, -1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(-1.f, 1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(1.f, -1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(1.f, 1.f, 0.f));
-	
-
-	// texture coordinates
-	retGeom.texCoords.push_back(glm::vec2(0.f, 1.f));
-	retGeom.texCoords.push_back(glm::vec2(0.f, 0.f));
-	retGeom.texCoords.push_back(glm::vec2(1.f, 0.f));
-	retGeom.texCoords.push_back(glm::vec2(0.f, 1.f));
-	retGeom.texCoords.push_back(glm::vec2(1.f, 0.f));
-	retGeom.texCoords.push_back(glm::vec2(1.f, 1.f));
-	return retGeom;
+// The simulation advances in fixed ticks, independent of the frame rate, at
+// Game::referenceTickRate unless --tick-rate says otherwise
+const uint32_t minTicksPerSecond = 10;
+const uint32_t maxTicksPerSecond = 10000;
+// Upper bound on ticks simulated per frame, so a long stall doesn't snowball
+const int maxTicksPerFrame = 100;
+// How far back Backspace can rewind, unless the level is too big to keep that much
+const uint32_t rollbackSeconds = 2;
+const size_t rollbackBudget = 64 << 20; // bytes
+// Benchmarks simulate a fixed 60 Hz worth of ticks per frame (at least one),
+// however long the frame took
+const uint32_t benchFramesPerSecond = 60;
+const uint32_t benchDefaultEntities = 10000;
+const uint32_t benchDefaultFrames = 1000;
+// --alloc-guard lets the loop warm up (ImGui buffers, trace chunks, ...) for this many frames first
+const uint64_t allocGuardWarmupFrames = 120;
+
+
+void LogReplayStats(uint64_t ticks, std::chrono::steady_clock::time_point start, const Game& game) {
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	Log::info("REPLAY {} ticks in {:.3f} s ({:.0f} ticks/s), final score {}", ticks, seconds, ticks / seconds, game.getState().header().score);
 }
 
-CPU_Geometry DiamondGeom(float width, float height) {
-	float halfWidth = width / 2.0f;
-	float halfHeight = height / 2.0f;
-
-	CPU_Geometry retGeom;
-	
-	retGeom.verts.push_back(glm::vec3(-1.f, 1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(-1.f, -1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(1.f, -1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(-1.f, 1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(1.f, -1.f, 0.f));
-	retGeom.verts.push_back(glm::vec3(1.f, 1.f, 0.f));
-
-	// texture coordinates
-	retGeom.texCoords.push_back(glm::vec2(0.f, 1.f));
-	retGeom.texCoords.push_back(glm::vec2(0.f, 0.f));
-	retGeom.texCoords.push_back(glm::vec2(1.f, 0.f));
-	retGeom.texCoords.push_back(glm::vec2(0.f, 1.f));
-	retGeom.texCoords.push_back(glm::vec2(1.f, 0.f));
-	retGeom.texCoords.push_back(glm::vec2(1.f, 1.f));
-	return retGeom;
+// Fixed-point recordings keep every tick's state hash (see InputRecording.h)
+void RecordHash(InputRecorder* recorder, const Game& game) {
+	if (recorder && recorder->recordsHashes()) {
+		recorder->recordHash(game.getState().hash());
+	}
 }
 
+// False, with an error, if the tick just replayed didn't end where it did
+// when it was recorded
+bool CheckReplay(const InputReplay& replay, const Game& game) {
+	if (replay.check(game.getState().hash())) {
+		return true;
+	}
+	Log::error("REPLAY diverged from the recording at tick {}", replay.getTick() - 1);
+	return false;
+}
 
-//////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////
-///////////////													//////////////////////////////
-///////////////				Movement Variables					//////////////////////////////
-///////////////													//////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////
-float movingDistance = 1.0f / 2000.0f;
-float rotationDistance = PI / 1500.0f;
+// Drives the game from a recording as fast as possible, without a window
+int RunHeadless(Game& game, InputReplay& replay, InputRecorder* recorder) {
+	auto start = std::chrono::steady_clock::now();
+	uint64_t ticks = 0;
+	TickInput input;
+	while (replay.next(input)) {
+		if (recorder) {
+			recorder->record(input);
+		}
+		game.tick(input);
+		RecordHash(recorder, game);
+		ticks++;
+		if (!CheckReplay(replay, game)) {
+			return 1;
+		}
+	}
+	LogReplayStats(ticks, start, game);
+	return 0;
+}
 
+// Every sprite's world transform: the ship, then the diamonds, then the fires
+void BuildTransforms(const GameState& state, std::vector<Affine2D>& transforms) {
+	const uint32_t count = state.getEntityCount();
+	transforms.resize(1 + 2 * static_cast<size_t>(count));
+	transforms[0] = Game::shipTransform(state);
+	Game::spriteTransforms(state, transforms.data() + 1, transforms.data() + 1 + count);
+}
 
+// Runs the benchmark without a window; "rendering" is building the transforms
+int RunHeadlessBench(Game& game, const BenchConfig& config, const std::string& reportPath, InputRecorder* recorder) {
+	using Clock = std::chrono::steady_clock;
+	using Milliseconds = std::chrono::duration<double, std::milli>;
+
+	BenchReport report(config);
+	std::vector<Affine2D> transforms;
+	transforms.reserve(1 + 2 * static_cast<size_t>(game.getState().getEntityCount()));
+	uint64_t ticks = 0;
+	for (uint32_t frame = 0; frame < config.frames; frame++) {
+		TRACE_ZONE("frame");
+		auto frameStart = Clock::now();
+		AllocTracker::Counts allocStart = AllocTracker::total();
+		for (uint32_t i = 0; i < config.ticksPerFrame; i++) {
+			TickInput input = BenchInput(ticks++);
+			if (recorder) {
+				recorder->record(input);
+			}
+			game.tick(input);
+			RecordHash(recorder, game);
+		}
+		auto simEnd = Clock::now();
+		{
+			TRACE_ZONE("draw");
+			BuildTransforms(game.getState(), transforms);
+		}
+		auto frameEnd = Clock::now();
+		AllocTracker::Counts allocated = AllocTracker::total() - allocStart;
+
+		BenchReport::Frame sample;
+		sample.frameMs = Milliseconds(frameEnd - frameStart).count();
+		sample.simMs = Milliseconds(simEnd - frameStart).count();
+		sample.renderMs = Milliseconds(frameEnd - simEnd).count();
+		sample.allocations = allocated.allocations;
+		sample.allocatedBytes = allocated.bytes;
+		report.addFrame(sample);
+	}
+	return report.write(reportPath, ticks, game.getState().header().score) ? 0 : 1;
+}
+
+// Every instance of a sprite in one draw call
+void DrawSprites(Sprite& sprite, const Affine2D* transforms, uint32_t count) {
+	if (count == 0) return;
+	sprite.ggeom.bind();
+	sprite.ggeom.setInstances(transforms, sizeof(Affine2D) * count);
+	sprite.texture.bind();
+	sprite.ggeom.drawInstanced(static_cast<GLsizei>(count));
+	RenderStats::countDraw(sprite.ggeom.triangleCount(), count);
+	sprite.texture.unbind();
+}
 
-int main() {
-	Log::debug("Starting main");
+
+// Usage:
+//   453-skeleton [--record=<file>] [--replay=<file> [--headless]] [--log-level=<level>] [--log-file=<file>] [--gl-async] [--trace=<file>]
+//                [--entities=<n>] [--seed=<s>] [--fixed-point] [--tick-rate=<hz>] [--vsync=on|off] [--simd=scalar|sse|avx2]
+//                [--sprite-mesh=trimmed|quad]
+//                [--bench [--frames=<n>] [--report=<file>] [--headless]]
+//
+// --record   saves every tick's input to <file>
+// --replay   drives the game from a recording as fast as possible, then exits
+// --headless with --replay or --bench, simulates without opening a window
+// --entities plays a generated level with <n> diamonds instead of the classic one
+// --seed     picks the generated level (default 1)
+// --fixed-point simulates in Q16.16 integers, so a recording replays exactly on
+//            any machine; replays check every tick against the recorded state
+// --tick-rate simulates <hz> ticks a second (10 to 10000, default 1000); the ship
+//            covers the same ground per second at any rate, and collisions are
+//            swept along each tick's motion, so low rates cost less without
+//            missing hits. A replay runs at the rate it was recorded at.
+// --vsync    off lets frames run as fast as they can
+// --simd     runs the sprite transform kernels with the given instructions rather
+//            than the best the CPU has
+// --sprite-mesh quad draws every sprite as its whole quad instead of a polygon
+//            trimmed to its opaque texels (the default), to compare fill rates
+// --bench    flies a scripted ship through a generated level (10000 entities unless
+//            given) for --frames frames (default 1000), then writes a JSON report of
+//            frame, sim and render times and allocations to --report (default stdout)
+//            and exits
+// --alloc-guard warns about heap allocations on the main thread once the loop has
+//            warmed up; --alloc-guard=break stops in the debugger at the first one
+// --log-level hides log lines below debug, info, warn or error
+// --log-file writes the log to <file> in binary form (read it with logdecode)
+// --gl-async lets the driver report OpenGL debug messages asynchronously (faster,
+//            but a breakpoint in the handler no longer lands in the failing call)
+// --trace    records frame trace zones from the start and writes them to <file> on
+//            exit, for chrome://tracing or Perfetto. Without it, F9 starts tracing
+//            and each further F9 writes trace.json.
+int main(int argc, char* argv[]) {
+	LOG_DEBUG("Starting main");
+
+	argh::parser cmdl(argc, argv);
+	std::string recordPath;
+	std::string replayPath;
+	cmdl("record") >> recordPath;
+	cmdl("replay") >> replayPath;
+	bool headless = cmdl["headless"];
+	bool glAsync = cmdl["gl-async"];
+	bool bench = cmdl["bench"];
+	bool fixedPoint = cmdl["fixed-point"];
+	uint32_t ticksPerSecond = Game::referenceTickRate;
+	cmdl("tick-rate", Game::referenceTickRate) >> ticksPerSecond;
+	if (ticksPerSecond < minTicksPerSecond || ticksPerSecond > maxTicksPerSecond) {
+		Log::error("--tick-rate must be {} to {}, not {}", minTicksPerSecond, maxTicksPerSecond, ticksPerSecond);
+		return 1;
+	}
+	std::string vsync;
+	cmdl("vsync", "on") >> vsync;
+	if (vsync != "on" && vsync != "off") {
+		Log::error("--vsync must be on or off, not {}", vsync);
+		return 1;
+	}
+	std::string allocGuardMode;
+	cmdl("alloc-guard") >> allocGuardMode;
+	bool allocGuard = cmdl["alloc-guard"] || !allocGuardMode.empty();
+	if (!allocGuardMode.empty() && allocGuardMode != "break") {
+		Log::error("--alloc-guard takes no value or break, not {}", allocGuardMode);
+		return 1;
+	}
+	AllocTracker::setBreakOnViolation(allocGuardMode == "break");
+	std::string simd;
+	if (cmdl("simd") >> simd) {
+		SpriteKernels::Isa isa;
+		if (!SpriteKernels::parseIsa(simd, isa)) {
+			Log::error("--simd must be scalar, sse or avx2, not {}", simd);
+			return 1;
+		}
+		if (!SpriteKernels::use(isa)) {
+			Log::error("--simd={} isn't supported here; the best is {}", simd, SpriteKernels::name(SpriteKernels::best()));
+			return 1;
+		}
+	}
+	std::string spriteMesh;
+	cmdl("sprite-mesh", "trimmed") >> spriteMesh;
+	if (spriteMesh != "trimmed" && spriteMesh != "quad") {
+		Log::error("--sprite-mesh must be trimmed or quad, not {}", spriteMesh);
+		return 1;
+	}
+	std::string logLevel;
+	if (cmdl("log-level") >> logLevel) {
+		Log::Level level;
+		if (!Log::parseLevel(logLevel, level)) {
+			Log::error("--log-level must be debug, info, warn or error, not {}", logLevel);
+			return 1;
+		}
+		Log::setLevel(level);
+	}
+	if (headless && replayPath.empty() && !bench) {
+		Log::error("--headless needs a recording or the benchmark to drive it (--replay=<file> or --bench)");
+		return 1;
+	}
+	if (bench && !replayPath.empty()) {
+		Log::error("--bench and --replay can't be combined");
+		return 1;
+	}
+	uint32_t benchFrames = benchDefaultFrames;
+	cmdl("frames", benchDefaultFrames) >> benchFrames;
+	if (bench && benchFrames == 0) {
+		Log::error("--frames must be at least 1");
+		return 1;
+	}
+
+	// From here on, logging only queues lines; a background thread writes them
+	std::string logFile;
+	cmdl("log-file") >> logFile;
+	Log::startAsync(logFile);
+	Trace::setThreadName("main");
+
+	std::string tracePath;
+	if (cmdl("trace") >> tracePath) {
+		Trace::start();
+	}
+
+	// A recording that can't be read or written is a bad argument like any
+	// other, not a crash
+	std::unique_ptr<InputReplay> replay;
+	if (!replayPath.empty()) {
+		try {
+			replay = std::make_unique<InputReplay>(replayPath);
+		}
+		catch (const std::runtime_error& error) {
+			Log::error("--replay: {}", error.what());
+			Log::stopAsync();
+			return 1;
+		}
+	}
+
+	// A replay brings its own level and tick rate; otherwise 0 entities means
+	// the classic level
+	uint32_t entities = 0;
+	uint64_t seed = 1;
+	if (replay) {
+		entities = replay->getEntityCount();
+		seed = replay->getSeed();
+		fixedPoint = replay->isFixedPoint();
+		if (replay->getTicksPerSecond() != ticksPerSecond && cmdl("tick-rate")) {
+			Log::warn("REPLAY {} was recorded at {} ticks/s; ignoring --tick-rate={}", replayPath, replay->getTicksPerSecond(), ticksPerSecond);
+		}
+		ticksPerSecond = replay->getTicksPerSecond();
+	}
+	else {
+		cmdl("entities", bench ? benchDefaultEntities : 0) >> entities;
+		cmdl("seed", 1) >> seed;
+	}
+	GameState level = entities ? Game::generatedLevel(entities, seed) : Game::classicLevel();
+
+	std::unique_ptr<InputRecorder> recorder;
+	if (!recordPath.empty()) {
+		try {
+			recorder = std::make_unique<InputRecorder>(recordPath, ticksPerSecond, entities ? seed : 0, entities, fixedPoint);
+		}
+		catch (const std::runtime_error& error) {
+			Log::error("--record: {}", error.what());
+			Log::stopAsync();
+			return 1;
+		}
+	}
+
+	// Worker threads for the per-entity update phases
+	JobSystem jobs;
+	Game game(level, jobs, fixedPoint ? Game::Arithmetic::FixedPoint : Game::Arithmetic::Float, ticksPerSecond);
+	const double tickLength = 1.0 / ticksPerSecond;
+
+	std::string reportPath;
+	BenchConfig benchConfig;
+	if (bench) {
+		cmdl("report") >> reportPath;
+		benchConfig.frames = benchFrames;
+		benchConfig.entities = entities;
+		benchConfig.seed = seed;
+		benchConfig.ticksPerSecond = ticksPerSecond;
+		benchConfig.ticksPerFrame = std::max(1u, ticksPerSecond / benchFramesPerSecond);
+		benchConfig.threads = jobs.threadCount();
+		benchConfig.simd = SpriteKernels::name(SpriteKernels::active());
+		benchConfig.fixedPoint = fixedPoint;
+		benchConfig.headless = headless;
+		benchConfig.vsync = !headless && vsync == "on";
+		benchConfig.spriteMesh = spriteMesh;
+	}
+
+	if (headless) {
+		// The masks the sprites' textures would have, so hits are the same
+		// as in a window
+		AlphaMask shipMask = AlphaMask::load("textures/ship.png");
+		AlphaMask diamondMask = AlphaMask::load("textures/diamond.png");
+		AlphaMask fireMask = AlphaMask::load("textures/fire.png");
+		game.setHitMasks(&shipMask, &diamondMask, &fireMask);
+
+		int result = bench
+			? RunHeadlessBench(game, benchConfig, reportPath, recorder.get())
+			: RunHeadless(game, *replay, recorder.get());
+		if (recorder) {
+			recorder->finish();
+		}
+		if (!tracePath.empty()) {
+			Trace::dump(tracePath);
+		}
+		Log::stopAsync();
+		return result;
+	}
+
+	// Rewindable history of the last few seconds
+	size_t historyTicks = std::min<size_t>(rollbackSeconds * ticksPerSecond, std::max<size_t>(1, rollbackBudget / game.getState().size()));
+	Rollback rollback(game, historyTicks);
 
 	int screenWidth = 800;
 	int	screenHeight = 800;
@@ -310,360 +548,276 @@ int main() {
 	// WINDOW
 	glfwInit();
 	Window window(screenWidth, screenHeight, "CPSC 453"); // can set callbacks at construction if desired
+	glfwSwapInterval(vsync == "on" ? 1 : 0);
 
 
-	GLDebug::enable();
+	GLDebug::enable(!glAsync);
 
 	// SHADERS
 	ShaderProgram shader("shaders/test.vert", "shaders/test.frag");
 
+	// F3 shows frame timings and render counters
+	PerfPanel perfPanel;
+	GpuTimer gpuTimer;
+
 	// CALLBACKS
-	auto callbacks = std::make_shared<MyCallbacks>(shader, screenWidth, screenHeight);
+	auto callbacks = std::make_shared<MyCallbacks>(shader, perfPanel, screenWidth, screenHeight, tracePath.empty() ? "trace.json" : tracePath);
 	window.setCallbacks(callbacks); // can also update callbacks to new ones
 
 
 	// GL_NEAREST looks a bit better for low-res pixel art than GL_LINEAR.
 	// But for most other cases, you'd want GL_LINEAR interpolation.
-	std::shared_ptr<GameObject> ship = std::make_shared<GameObject>("textures/ship.png", GL_NEAREST);
-
-
-	ship->defaultTransformationMatrix = MakeScaleMatrixXY(0.15f, 0.10);
-	ship->defaultPosition = glm::vec4(0.f);
-	ship->cgeom = shipGeom(0.15f, 0.12f);
-	ship->ggeom.setVerts(ship->cgeom.verts);
-	ship->ggeom.setTexCoords(ship->cgeom.texCoords);
-	ship->theta = PI / 2.0f;
-	ship->transformationMatrix = ship->defaultTransformationMatrix;
-
-
-	std::vector<std::shared_ptr<GameObject>> diamonds;
-
-	for (int i = 0; i < 3; i++) {
-		std::shared_ptr<GameObject> d = std::make_shared<GameObject>("textures/diamond.png", GL_LINEAR);
-		d->cgeom = DiamondGeom(0.2f, 0.2f);
-		d->ggeom.setVerts(d->cgeom.verts);
-		d->ggeom.setTexCoords(d->cgeom.texCoords);
-		diamonds.push_back(d);
+	const bool trimSprites = spriteMesh == "trimmed";
+	Sprite shipSprite("textures/ship.png", GL_NEAREST, shipGeom(), trimSprites);
+	Sprite diamondSprite("textures/diamond.png", GL_LINEAR, DiamondGeom(), trimSprites);
+	Sprite fireSprite("textures/fire.png", GL_LINEAR, DiamondGeom(), trimSprites);
+	game.setHitMasks(&shipSprite.texture.getAlphaMask(), &diamondSprite.texture.getAlphaMask(), &fireSprite.texture.getAlphaMask());
+
+	// Input arrives through the callbacks' queue and is applied tick by tick
+	InputQueue& inputQueue = callbacks->GetInputQueue();
+	InputState inputState;
+	double simTime = glfwGetTime();
+	bool replayDone = false;
+	bool replayDiverged = false;
+	auto runStart = std::chrono::steady_clock::now();
+	uint64_t totalTicks = 0;
+	auto frameStart = std::chrono::steady_clock::now();
+	uint64_t frameIndex = 0;
+	AllocTracker::Counts allocBaseline = AllocTracker::total();
+	uint64_t guardedViolations = 0;
+	double lastAllocWarning = -1.0;
+	// Rebuilt every frame; only grows when a level has more entities
+	std::vector<Affine2D> transforms;
+	std::unique_ptr<BenchReport> benchReport;
+	if (bench) {
+		benchReport = std::make_unique<BenchReport>(benchConfig);
 	}
 
-	diamonds.at(0)->defaultTransformationMatrix = MakeTranslationMatrix(1, PI / 4) * MakeScaleMatrix(0.10f);
-	diamonds.at(1)->defaultTransformationMatrix = MakeTranslationMatrix(1, 3 * PI / 4) * MakeScaleMatrix(0.10f);
-	diamonds.at(2)->defaultTransformationMatrix = MakeTranslationMatrix(0.8, 3 * PI / 2) * MakeScaleMatrix(0.10f);
-	diamonds.at(0)->position = glm::vec4(glm::vec3(cos(PI/4), sin(PI/4), 0), 0.f);
-	diamonds.at(1)->position = glm::vec4(glm::vec3(cos(3*PI/4), sin(3 * PI / 4), 0), 0.f);
-	diamonds.at(2)->position = glm::vec4(glm::vec3(0, -0.8f, 0), 0.f);
-
-	for (int i = 0; i < diamonds.size(); i++) {
-		diamonds.at(i)->defaultPosition = diamonds.at(i)->position;
-		diamonds.at(i)->transformationMatrix = diamonds.at(i)->defaultTransformationMatrix;
-	}
-
-	std::vector<std::shared_ptr<GameObject>> fires;
-	for (int i = 0; i < 3; i++) {
-		std::shared_ptr<GameObject> f = std::make_shared<GameObject>("textures/fire.png", GL_LINEAR);
-		f->cgeom = DiamondGeom(0.2f, 0.2f);
-		f->ggeom.setVerts(f->cgeom.verts);
-		f->ggeom.setTexCoords(f->cgeom.texCoords);
-		f->position = diamonds.at(i)->position;
-		f->position.y += 0.2f;
-		f->theta = PI / 2;
-		f->transformationMatrix = MakeScaleMatrixXY(0.3f, 0.4f);
-		f->transformationMatrix = diamonds.at(i)->transformationMatrix * f->transformationMatrix;
-		f->transformationMatrix = MakeTranslationMatrixXY(0, 0.2f) * f->transformationMatrix;
-		f->defaultTransformationMatrix = f->transformationMatrix;
-		f->active = true;
-		fires.push_back(f);
-	}
-
-
 	// RENDER LOOP
 	while (!window.shouldClose()) {
-		glfwPollEvents();
+		TRACE_ZONE("frame");
+		auto previousFrameStart = frameStart;
+		frameStart = std::chrono::steady_clock::now();
+		RenderStats::frame = RenderCounters();
+		bool allocGuarded = allocGuard && frameIndex >= allocGuardWarmupFrames;
+		uint64_t violationsBefore = AllocTracker::violations();
+		AllocTracker::forbid(allocGuarded);
+		{
+			TRACE_ZONE("pollEvents");
+			glfwPollEvents();
+		}
 
 		shader.use();
 
-		GLint myLoc = glGetUniformLocation(shader.GetProgram(), "transformation");
-
-		//Moving forward
-		if (callbacks ->GetMoveForward()){
-			ship->transformationMatrix = MakeTranslationMatrix(movingDistance, ship->theta) * ship->transformationMatrix;
-			ship->position.x = ship->position.x + movingDistance * cos(ship->theta);
-			ship->position.y = ship->position.y + movingDistance * sin(ship->theta);
-
-			//moving the children forward and saving the transformations for the fires for after
-			for (int i = 0; i < ship->children.size(); i++) {
-				glm::mat4 matrix = MakeTranslationMatrix(movingDistance, ship->theta);
-				ship->children.at(i)->position.x += movingDistance * cos(ship->theta);
-				ship->children.at(i)->position.y += movingDistance * sin(ship->theta);
-				ship->children.at(i)->transformationMatrix = matrix * ship->children.at(i)->transformationMatrix;
-				ship->children.at(i)->transformations.push_back(matrix);
-			}
-
-			//Hitboxes for diamonds
-			for (int i = 0; i < diamonds.size(); i++) {
-				if (diamonds.at(i)->active) {
-
-					//succesful hit on a diamond while moving forward and its active
-					if (Close(diamonds.at(i)->position, ship->position)) {
-						diamonds.at(i)->active = false;
-						score ++ ;
-						ship->transformationMatrix = Reset(ship->position, 1.f) * MakeScaleMatrix(1.1f) * Reset(ship->position, -1.f) * ship->transformationMatrix;
-						ship->children.push_back(diamonds.at(i));
-						diamonds.at(i)->parent = ship;
-						diamonds.at(i)->theta = ship->theta;
-						glm::mat4 matrix = Reset(diamonds.at(i)->position, 1.f) * MakeScaleMatrix(0.5f) * Reset(diamonds.at(i)->position, -1.f);
-						glm::mat4 matrix2 = MakeChildrenMatrix(ship->position, ship->theta, diamonds.at(i)->position, ship->children.size());
-						diamonds.at(i)->transformationMatrix = matrix2 *matrix * diamonds.at(i)->transformationMatrix;
-						diamonds.at(i)->transformations.push_back(matrix);
-						diamonds.at(i)->transformations.push_back(matrix2);
-						diamonds.at(i)->position.x = ship->position.x + cos(ship->theta + PI) * ship->children.size() * 0.15f;
-						diamonds.at(i)->position.y = ship->position.y + sin(ship->theta + PI) * ship->children.size() * 0.15f;
-						fires.at(i)->active = false;		//disabling the fire so it doesn't hit the ship
+		// Simulate every tick that has fully elapsed, feeding each one exactly the
+		// input events that arrived before it ended. Replays ignore the clock.
+		// The benchmark runs a fixed number of ticks per frame instead.
+		double now = glfwGetTime();
+		auto simStart = std::chrono::steady_clock::now();
+		{
+			TRACE_ZONE("simulate");
+			int ticks = 0;
+			int tickLimit = bench ? static_cast<int>(benchConfig.ticksPerFrame) : maxTicksPerFrame;
+			while ((replay || bench || simTime + tickLength <= now) && ticks < tickLimit) {
+				TickInput input;
+				if (replay) {
+					if (!replay->next(input)) {
+						replayDone = true;
+						break;
 					}
 				}
-			}
-		}
-
-		//moving backwards
-		if (callbacks->GetMoveBack()) {
-			ship->transformationMatrix = MakeTranslationMatrix(-movingDistance, ship->theta) * ship->transformationMatrix;
-			ship->position.x = ship->position.x - movingDistance * cos(ship->theta);
-			ship->position.y = ship->position.y - movingDistance * sin(ship->theta);
-
-			//Moving children and saving the transformations for the fires for after
-			for (int i = 0; i < ship->children.size(); i++) {
-				glm::mat4 matrix = MakeTranslationMatrix(-movingDistance, ship->theta);
-				ship->children.at(i)->position.x += -movingDistance * cos(ship->theta);
-				ship->children.at(i)->position.y += -movingDistance * sin(ship->theta);
-				ship->children.at(i)->transformationMatrix = matrix * ship->children.at(i)->transformationMatrix;
-				ship->children.at(i)->transformations.push_back(matrix);
-			}
-
-			//Hitboxes for diamonds
-			for (int i = 0; i < diamonds.size(); i++) {
-				if (diamonds.at(i)->active) {
-					if (Close(diamonds.at(i)->position, ship->position)) {
-						diamonds.at(i)->active = false;
-						score ++;
-						ship->transformationMatrix = Reset(ship->position, 1.f) * MakeScaleMatrix(1.1f) * Reset(ship->position, -1.f) * ship->transformationMatrix;
-						ship->children.push_back(diamonds.at(i));
-						diamonds.at(i)->theta = ship->theta;
-						diamonds.at(i)->parent = ship;
-						glm::mat4 matrix = Reset(diamonds.at(i)->position, 1.f) * MakeScaleMatrix(0.5f) * Reset(diamonds.at(i)->position, -1.f);
-						glm::mat4 matrix2 = MakeChildrenMatrix(ship->position, ship->theta, diamonds.at(i)->position, ship->children.size());
-						diamonds.at(i)->transformationMatrix = matrix2 * matrix * diamonds.at(i)->transformationMatrix;
-						diamonds.at(i)->transformations.push_back(matrix);
-						diamonds.at(i)->transformations.push_back(matrix2);
-						diamonds.at(i)->position.x += ship->position.x - diamonds.at(i)->position.x + cos(ship->theta + PI) * ship->children.size() * 0.15f;
-						diamonds.at(i)->position.y += ship->position.y - diamonds.at(i)->position.y + sin(ship->theta + PI) * ship->children.size() * 0.15f;
-						fires.at(i)->active = false;
+				else if (bench) {
+					input = BenchInput(totalTicks);
+				}
+				else {
+					simTime += tickLength;
+					while (const InputEvent* e = inputQueue.front()) {
+						if (e->time > simTime) break;
+						inputState.Apply(*e);
+						inputQueue.pop();
+					}
+					input = inputState.TakeTick();
+
+					// Rewinding would desync a recording, so it's off while recording
+					if (inputState.IsRewinding() && !recorder) {
+						if (rollback.getTick() > rollback.getOldestTick()) {
+							rollback.rewind(rollback.getTick() - 1);
+						}
+						ticks++;
+						continue;
 					}
 				}
-			}
-		}
-
-		//turning
-		if (callbacks->GetLeftPressed()) {
-			callbacks-> GLmouse();
-			float x = callbacks->GetClickPosition().x;
-			float y = callbacks->GetClickPosition().y;
-			x = x - ship->position.x;
-			y = y - ship->position.y;
-			float angle = atan2(y,x);
-
-			//if the turning distance is more than how much we rotate by then rotate else don't do anything
-			if (abs(ship->theta - angle) > rotationDistance) {
-				if (angle < 0) {
-					angle += 2 * PI;
+				ticks++;
+				totalTicks++;
+				if (recorder) {
+					recorder->record(input);
 				}
-
-				//If going clockwise is more eficient
-				if (!Goleft(ship->theta,angle)) {
-					ship->transformationMatrix = Reset(ship->position, 1.f) * MakeRotationMatrix(rotationDistance) * Reset(ship->position, -1.f) * ship->transformationMatrix;
-					ship->theta -= rotationDistance;
-
-					//rotate children and fires of the children
-					for (int i = 0; i < ship->children.size(); i++) {
-						glm::mat4 matrix = Reset(ship->position, 1.f) * MakeRotationMatrix(rotationDistance) * Reset(ship->position, -1.f);
-						ship->children.at(i)->transformationMatrix = matrix * ship->children.at(i)->transformationMatrix;
-						ship->children.at(i)->theta = ship->theta;
-						ship->children.at(i)->position.x = ship->position.x + cos(ship->theta + PI) * (i+1) * 0.15f;
-						ship->children.at(i)->position.y = ship->position.y + sin(ship->theta + PI) * (i+1) * 0.15f;
-						ship->children.at(i)->transformations.push_back(matrix);
-					}
+				// Nothing rewinds a benchmark, so it skips keeping history
+				if (bench) {
+					game.tick(input);
 				}
-
-				//if going counterclockwise is more efficient
 				else {
-					ship->transformationMatrix = Reset(ship->position, 1.f) * MakeRotationMatrix(-rotationDistance) * Reset(ship->position, -1.f) * ship->transformationMatrix;
-					ship->theta += rotationDistance;
-
-					//rotate children and fires of the children
-					for (int i = 0; i < ship->children.size(); i++) {
-						glm::mat4 matrix = Reset(ship->position, 1.f) * MakeRotationMatrix(-rotationDistance) * Reset(ship->position, -1.f);
-						ship->children.at(i)->transformationMatrix = matrix * ship->children.at(i)->transformationMatrix;
-						ship->children.at(i)->theta = ship->theta;
-						ship->children.at(i)->position.x = ship->position.x + cos(ship->theta + PI) * (i + 1) * 0.15f;
-						ship->children.at(i)->position.y = ship->position.y + sin(ship->theta + PI) * (i + 1) * 0.15f;
-						ship->children.at(i)->transformations.push_back(matrix);
-					}
+					rollback.tick(input);
+				}
+				RecordHash(recorder.get(), game);
+				if (replay && !CheckReplay(*replay, game)) {
+					replayDone = true;
+					replayDiverged = true;
+					break;
 				}
-				//making sure angle stays between 0 and 2PI
-				if (ship->theta >= 2 * PI) ship->theta -= 2 * PI;
-				if (ship->theta <= 0) ship->theta += 2 * PI;
+			}
+			// Too far behind (e.g. the window was dragged); drop the backlog instead of catching up
+			if (!replay && !bench && ticks == maxTicksPerFrame) {
+				simTime = now;
 			}
 		}
+		double simMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - simStart).count();
 
-		//resest game if player pressed space
-		if (callbacks->GetReset()) {
-			ship->transformationMatrix = ship->defaultTransformationMatrix;
-			ship->theta = PI / 2;
-			ship->position = ship->defaultPosition;
-			ship->children.clear();
-			for (int i = 0; i < diamonds.size(); i++) {
-				std::cout << diamonds.at(i)->parent << std::endl;
-				diamonds.at(i)->transformationMatrix = diamonds.at(i)->defaultTransformationMatrix;
-				diamonds.at(i)->active = true;
-				diamonds.at(i)->parent = nullptr;
-				diamonds.at(i)->position = diamonds.at(i)->defaultPosition;
-				diamonds.at(i)->theta = 0;
+		if (replay || bench) {
+			// Live input has no say during a replay or benchmark
+			while (inputQueue.front()) {
+				inputQueue.pop();
 			}
-			for (int i = 0; i < fires.size(); i++) {
-				fires.at(i)->transformationMatrix = fires.at(i)->defaultTransformationMatrix;
-				fires.at(i)->active = true;
-				fires.at(i)->position = fires.at(i)->defaultPosition;
-				fires.at(i)->theta = PI/2;
+			if (replayDone) {
+				AllocTracker::forbid(false);
+				break;
 			}
-			score = 0;
-			callbacks->ResetDone();
 		}
 
-		glUniformMatrix4fv(myLoc,
-			1,
-			false,
-			&ship->transformationMatrix[0][0]
-		);
+		const GameState& state = game.getState();
 
-		ship->ggeom.bind();
+		auto renderStart = std::chrono::steady_clock::now();
+		gpuTimer.begin();
 		glEnable(GL_FRAMEBUFFER_SRGB);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		ship->texture.bind();
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		ship->texture.unbind();
-
-		for (int i = 0; i < diamonds.size(); i++) {
-			if (score >= diamonds.size()) {
-				diamonds.at(i)->transformationMatrix = Reset(diamonds.at(i)->position, 1.f) * MakeRotationMatrix(rotationDistance) * Reset(diamonds.at(i)->position, -1.f) * diamonds.at(i)->transformationMatrix;
-			}
-				glUniformMatrix4fv(myLoc,
-					1,
-					false,
-					&diamonds.at(i)->transformationMatrix[0][0]
-				);
-				diamonds.at(i)->ggeom.bind();
-				diamonds.at(i)->texture.bind();
-				glDrawArrays(GL_TRIANGLES, 0, 6);
-				diamonds.at(i)->texture.unbind();
-			
-		}
-		for (int i = 0; i < fires.size(); i++) {
-
-			fires.at(i)->transformationMatrix = Reset(diamonds.at(i)->position, 1) * MakeRotationMatrix(rotationDistance) * Reset(diamonds.at(i)->position, -1) * fires.at(i)->transformationMatrix;
-			fires.at(i)->theta += rotationDistance;
-			fires.at(i)->position.x = diamonds.at(i)->position.x - 0.2f * cos(fires.at(i)->theta);
-			fires.at(i)->position.y = 0.2f * sin(fires.at(i)->theta) + diamonds.at(i)->position.y;
-			for (int j = 0; j < diamonds.at(i)->transformations.size(); j++) {
-				fires.at(i)->transformationMatrix = diamonds.at(i)->transformations.at(j) * fires.at(i)->transformationMatrix;
-			}
-			diamonds.at(i)->transformations.clear();
-			glUniformMatrix4fv(myLoc,
-				1,
-				false,
-				&fires.at(i)->transformationMatrix[0][0]
-			);
-			fires.at(i)->ggeom.bind();
-			fires.at(i)->texture.bind();
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			fires.at(i)->texture.unbind();
-		}
-
 
-		//hitbox for fire
-		for (int i = 0; i < fires.size(); i++) {
-			if (fires.at(i)->active) {
-				//reset game if fire was hit while it was active ie parent of fire not child of ship
-				if (Close(fires.at(i)->position, ship->position)) {
-					ship->transformationMatrix = ship->defaultTransformationMatrix;
-					ship->theta = PI / 2;
-					ship->position = ship->defaultPosition;
-					ship->children.clear();
-					for (int i = 0; i < diamonds.size(); i++) {
-						std::cout << diamonds.at(i)->parent << std::endl;
-						diamonds.at(i)->transformationMatrix = diamonds.at(i)->defaultTransformationMatrix;
-						diamonds.at(i)->active = true;
-						diamonds.at(i)->parent = nullptr;
-						diamonds.at(i)->position = diamonds.at(i)->defaultPosition;
-						diamonds.at(i)->theta = 0;
-					}
-					for (int i = 0; i < fires.size(); i++) {
-						fires.at(i)->transformationMatrix = fires.at(i)->defaultTransformationMatrix;
-						fires.at(i)->active = true;
-						fires.at(i)->position = fires.at(i)->defaultPosition;
-						fires.at(i)->theta = PI/2;
-					}
-					score = 0;
-					callbacks->ResetDone();
-				}
-			}
+		{
+			TRACE_ZONE("draw");
+			BuildTransforms(state, transforms);
+			const uint32_t count = state.getEntityCount();
+			DrawSprites(shipSprite, transforms.data(), 1);
+			DrawSprites(diamondSprite, transforms.data() + 1, count);
+			DrawSprites(fireSprite, transforms.data() + 1 + count, count);
 		}
 
 		glDisable(GL_FRAMEBUFFER_SRGB); // disable sRGB for things like imgui
 		
 
-		// Starting the new ImGui frame
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
-		// Putting the text-containing window in the top-left of the screen.
-		ImGui::SetNextWindowPos(ImVec2(5, 5));
-
-		// Setting flags
-		ImGuiWindowFlags textWindowFlags =
-			ImGuiWindowFlags_NoMove |				// text "window" should not move
-			ImGuiWindowFlags_NoResize |				// should not resize
-			ImGuiWindowFlags_NoCollapse |			// should not collapse
-			ImGuiWindowFlags_NoSavedSettings |		// don't want saved settings mucking things up
-			ImGuiWindowFlags_AlwaysAutoResize |		// window should auto-resize to fit the text
-			ImGuiWindowFlags_NoBackground |			// window should be transparent; only the text should be visible
-			ImGuiWindowFlags_NoDecoration |			// no decoration; only the text should be visible
-			ImGuiWindowFlags_NoTitleBar;			// no title; only the text should be visible
-
-		// Begin a new window with these flags. (bool *)0 is the "default" value for its argument.
-		ImGui::Begin("scoreText", (bool *)0, textWindowFlags);
-
-		// Scale up text a little, and set its value
-		ImGui::SetWindowFontScale(1.5f);
-		ImGui::Text("Score: %d", score ); // Second parameter gets passed into "%d"
-		if (score >= diamonds.size()) {
-			ImGui::SetWindowFontScale(8.0f);
-			ImGui::Text("\n\n  YOU WIN!!!");
-			ImGui::SetWindowFontScale(4.0f);
-			ImGui::Text("   Press Space to reset");
-		}
+		{
+			TRACE_ZONE("imgui");
+			// Starting the new ImGui frame
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
+			// Putting the text-containing window in the top-left of the screen.
+			ImGui::SetNextWindowPos(ImVec2(5, 5));
+
+			// Setting flags
+			ImGuiWindowFlags textWindowFlags =
+				ImGuiWindowFlags_NoMove |				// text "window" should not move
+				ImGuiWindowFlags_NoResize |				// should not resize
+				ImGuiWindowFlags_NoCollapse |			// should not collapse
+				ImGuiWindowFlags_NoSavedSettings |		// don't want saved settings mucking things up
+				ImGuiWindowFlags_AlwaysAutoResize |		// window should auto-resize to fit the text
+				ImGuiWindowFlags_NoBackground |			// window should be transparent; only the text should be visible
+				ImGuiWindowFlags_NoDecoration |			// no decoration; only the text should be visible
+				ImGuiWindowFlags_NoTitleBar;			// no title; only the text should be visible
+
+			// Begin a new window with these flags. (bool *)0 is the "default" value for its argument.
+			ImGui::Begin("scoreText", (bool *)0, textWindowFlags);
+
+			// Scale up text a little, and set its value
+			ImGui::SetWindowFontScale(1.5f);
+			ImGui::Text("Score: %d", state.header().score); // Second parameter gets passed into "%d"
+			if (game.isWon()) {
+				ImGui::SetWindowFontScale(8.0f);
+				ImGui::Text("\n\n  YOU WIN!!!");
+				ImGui::SetWindowFontScale(4.0f);
+				ImGui::Text("   Press Space to reset");
+			}
 
-		// End the window.
-		ImGui::End();
+			// End the window.
+			ImGui::End();
 
-		ImGui::Render();	// Render the ImGui window
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Some middleware thing
+			perfPanel.draw();
 
-		window.swapBuffers();
+			ImGui::Render();	// Render the ImGui window
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Some middleware thing
+		}
+		gpuTimer.end();
+
+		// CPU time stops short of the swap, which mostly waits on vsync
+		auto renderEnd = std::chrono::steady_clock::now();
+		PerfPanel::Frame frame;
+		frame.intervalMs = std::chrono::duration<double, std::milli>(frameStart - previousFrameStart).count();
+		frame.cpuMs = std::chrono::duration<double, std::milli>(renderEnd - frameStart).count();
+		frame.counters = RenderStats::frame;
+		AllocTracker::Counts allocNow = AllocTracker::total();
+		frame.allocations = (allocNow - allocBaseline).allocations;
+		frame.allocatedBytes = (allocNow - allocBaseline).bytes;
+		allocBaseline = allocNow;
+		perfPanel.addFrame(frame);
+
+		{
+			TRACE_ZONE("swapBuffers");
+			window.swapBuffers();
+		}
+		double gpuMs;
+		if (gpuTimer.poll(gpuMs)) {
+			perfPanel.addGpuTime(gpuMs);
+		}
+		GLDebug::update();
+
+		AllocTracker::forbid(false);
+		if (allocGuarded) {
+			uint64_t violations = AllocTracker::violations() - violationsBefore;
+			guardedViolations += violations;
+			if (violations && glfwGetTime() - lastAllocWarning >= 1.0) {
+				LOG_WARN("ALLOC {} heap allocations on the main thread in frame {}; trace it (F9) to see which zones allocate", violations, frameIndex);
+				lastAllocWarning = glfwGetTime();
+			}
+		}
+		frameIndex++;
+
+		if (benchReport) {
+			BenchReport::Frame sample;
+			sample.frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			sample.simMs = simMs;
+			sample.renderMs = std::chrono::duration<double, std::milli>(renderEnd - renderStart).count();
+			sample.allocations = frame.allocations;
+			sample.allocatedBytes = frame.allocatedBytes;
+			benchReport->addFrame(sample);
+			if (benchReport->getFrameCount() == benchConfig.frames) {
+				break;
+			}
+		}
+	}
+	GLDebug::logSummary();
+	if (allocGuard && frameIndex > allocGuardWarmupFrames) {
+		Log::info("ALLOC {} heap allocations on the main thread in {} steady-state frames", guardedViolations, frameIndex - allocGuardWarmupFrames);
+	}
+	if (!tracePath.empty()) {
+		Trace::dump(tracePath);
+	}
+
+	if (replay) {
+		LogReplayStats(totalTicks, runStart, game);
+	}
+	// A desync fails the run, windowed or headless
+	int result = replayDiverged ? 1 : 0;
+	if (benchReport && !benchReport->write(reportPath, totalTicks, game.getState().header().score)) {
+		result = 1;
+	}
+	if (recorder) {
+		recorder->finish();
 	}
+
 	// ImGui cleanup
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 
 	glfwTerminate();
-	return 0;
+	Log::stopAsync();
+	return result;
 }
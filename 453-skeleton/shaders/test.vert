@@ -2,10 +2,14 @@
 layout (location = 0) in vec3 pos;
 layout (location = 1) in vec2 texCoord;
 
+// Per instance: the sprite's Affine2D, column by column
+layout (location = 2) in vec2 axisX;
+layout (location = 3) in vec2 axisY;
+layout (location = 4) in vec2 translation;
+
 out vec2 tc;
-uniform mat4 transformation;
 
 void main() {
 	tc = texCoord;
-	gl_Position = transformation * vec4(pos, 1.0);
+	gl_Position = vec4(axisX * pos.x + axisY * pos.y + translation, pos.z, 1.0);
 }
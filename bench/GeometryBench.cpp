@@ -0,0 +1,16 @@
+#include "Harness.h"
+
+#include "Geometry.h"
+
+
+void AddGeometryBenchmarks() {
+	const size_t quads = 64;
+	Micro::add("geometry", "quad", quads, [quads]() {
+		return [quads]() {
+			for (size_t i = 0; i < quads; i++) {
+				CPU_Geometry geometry = shipGeom();
+				Micro::doNotOptimize(geometry.verts.data());
+			}
+		};
+	});
+}
@@ -0,0 +1,107 @@
+#include "Harness.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+
+namespace Micro::detail {
+	const void* volatile sink = nullptr;
+}
+
+
+namespace {
+	struct Benchmark {
+		std::string group;
+		std::string variant;
+		size_t items;
+		Micro::Setup setup;
+		Micro::Run between;
+	};
+
+	std::vector<Benchmark>& registry() {
+		static std::vector<Benchmark> benchmarks;
+		return benchmarks;
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	double timeRuns(const Micro::Run& run, const Micro::Run& between, size_t runs) {
+		if (!between) {
+			auto start = Clock::now();
+			for (size_t i = 0; i < runs; i++) {
+				run();
+			}
+			return std::chrono::duration<double>(Clock::now() - start).count();
+		}
+		double seconds = 0.0;
+		for (size_t i = 0; i < runs; i++) {
+			auto start = Clock::now();
+			run();
+			seconds += std::chrono::duration<double>(Clock::now() - start).count();
+			between();
+		}
+		return seconds;
+	}
+}
+
+
+namespace Micro {
+	void add(const std::string& group, const std::string& variant, size_t items, Setup setup, Run between) {
+		registry().push_back({ group, variant, items, std::move(setup), std::move(between) });
+	}
+
+
+	std::vector<Result> runAll(const std::string& filter, int samples, double sampleSeconds) {
+		std::vector<Result> results;
+		for (const Benchmark& benchmark : registry()) {
+			std::string name = benchmark.group + "/" + benchmark.variant;
+			if (name.find(filter) == std::string::npos) continue;
+
+			Run run = benchmark.setup();
+
+			// Warm up, then double the run count until one sample lasts long enough
+			run();
+			if (benchmark.between) benchmark.between();
+			size_t runs = 1;
+			while (timeRuns(run, benchmark.between, runs) < sampleSeconds && runs < (size_t(1) << 30)) {
+				runs *= 2;
+			}
+
+			std::vector<double> perItem;
+			for (int s = 0; s < samples; s++) {
+				double seconds = timeRuns(run, benchmark.between, runs);
+				perItem.push_back(seconds * 1e9 / (static_cast<double>(runs) * benchmark.items));
+			}
+			std::sort(perItem.begin(), perItem.end());
+
+			Result result;
+			result.group = benchmark.group;
+			result.variant = benchmark.variant;
+			result.items = benchmark.items;
+			result.runs = runs * samples;
+			result.nsPerItem = perItem[perItem.size() / 2];
+			result.minNsPerItem = perItem.front();
+			results.push_back(result);
+
+			std::fprintf(stderr, "%-32s %10zu items  %10.3f ns/item  %12.0f items/ms\n", name.c_str(), result.items, result.nsPerItem, 1e6 / result.nsPerItem);
+		}
+		return results;
+	}
+
+
+	std::string toJson(const std::vector<Result>& results) {
+		fmt::memory_buffer out;
+		fmt::format_to(out, "[\n");
+		for (size_t i = 0; i < results.size(); i++) {
+			const Result& r = results[i];
+			fmt::format_to(out,
+				"  {{ \"group\": \"{}\", \"variant\": \"{}\", \"items\": {}, \"runs\": {}, \"ns_per_item\": {:.4f}, \"min_ns_per_item\": {:.4f}, \"items_per_ms\": {:.0f} }}{}\n",
+				r.group, r.variant, r.items, r.runs, r.nsPerItem, r.minNsPerItem, 1e6 / r.nsPerItem, i + 1 < results.size() ? "," : "");
+		}
+		fmt::format_to(out, "]\n");
+		return fmt::to_string(out);
+	}
+}
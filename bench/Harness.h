@@ -0,0 +1,68 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A tiny microbenchmark harness.
+//
+// A benchmark is a group (the primitive being measured, e.g. "close"), a
+// variant (how it's implemented, e.g. "scalar") and a number of items handled
+// per run. Setup happens once, outside the timing; it returns the function that
+// gets timed. Variants of the same group process the same inputs, so a new
+// implementation (SIMD, structure-of-arrays, ...) registers next to the old one
+// and the two show up side by side in the report.
+//
+// Example:
+//   Micro::add("close", "scalar", n, [n]() {
+//       auto points = std::make_shared<std::vector<glm::vec2>>(RandomPoints(n));
+//       return [points]() { ... Micro::doNotOptimize(result); };
+//   });
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace Micro {
+	using Run = std::function<void()>;
+	using Setup = std::function<Run()>;
+
+	struct Result {
+		std::string group;
+		std::string variant;
+		size_t items = 0;
+		size_t runs = 0;			// timed runs across all samples
+		double nsPerItem = 0.0;		// median over samples
+		double minNsPerItem = 0.0;
+	};
+
+	// `between`, if given, runs untimed after every run, e.g. to drain a queue
+	// the run fills. Runs are then timed one at a time, so they should take
+	// well over a microsecond each.
+	void add(const std::string& group, const std::string& variant, size_t items, Setup setup, Run between = nullptr);
+
+	// Runs every benchmark whose "group/variant" name contains `filter`.
+	// Each one takes `samples` samples of at least `sampleSeconds` each.
+	std::vector<Result> runAll(const std::string& filter, int samples, double sampleSeconds);
+
+	std::string toJson(const std::vector<Result>& results);
+
+	namespace detail {
+		extern const void* volatile sink;
+	}
+
+	// Keeps the compiler from optimizing away a result nothing else reads
+	template <typename T>
+	inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+		detail::sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "r,m"(value) : "memory");
+#endif
+	}
+}
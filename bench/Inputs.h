@@ -0,0 +1,54 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Reproducible random inputs shared by the benchmarks, so every variant of a
+// group sees exactly the same data.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace Inputs {
+	// Element counts: one that stays in cache and one that streams from memory
+	const size_t small = 1024;
+	const size_t large = size_t(1) << 20;
+
+	class Random {
+	public:
+		explicit Random(uint64_t seed) : state(seed) {}
+
+		// Uniform in [low, high)
+		float uniform(float low, float high) {
+			state = state * 6364136223846793005ull + 1442695040888963407ull;
+			float unit = static_cast<float>(state >> 40) / static_cast<float>(1 << 24);
+			return low + (high - low) * unit;
+		}
+
+	private:
+		uint64_t state;
+	};
+
+	// Points in the visible [-1, 1] square
+	inline std::vector<glm::vec2> points(size_t n, uint64_t seed) {
+		Random random(seed);
+		std::vector<glm::vec2> result(n);
+		for (glm::vec2& p : result) {
+			p = glm::vec2(random.uniform(-1.f, 1.f), random.uniform(-1.f, 1.f));
+		}
+		return result;
+	}
+
+	// Angles in [0, 2PI)
+	inline std::vector<float> angles(size_t n, uint64_t seed) {
+		Random random(seed);
+		std::vector<float> result(n);
+		for (float& a : result) {
+			a = random.uniform(0.f, 6.2831853f);
+		}
+		return result;
+	}
+}
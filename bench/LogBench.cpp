@@ -0,0 +1,50 @@
+#include "Harness.h"
+
+#include "Log.h"
+
+#include <filesystem>
+
+
+namespace {
+	// Well under the async ring's 1024 lines
+	const size_t linesPerRun = 256;
+}
+
+
+void AddLogBenchmarks() {
+	// A call below the runtime level: the cost of logging that's switched off
+	Micro::add("log", "filtered", linesPerRun, []() {
+		return []() {
+			Log::setLevel(Log::Level::Error);
+			for (size_t i = 0; i < linesPerRun; i++) {
+				LOG_DEBUG("BENCH tick {} took {:.2f} ms for {}", i, 1.25, "entities");
+			}
+			Log::setLevel(Log::Level::Debug);
+		};
+	});
+
+	// What a synchronous call does before writing the line
+	Micro::add("log", "format", linesPerRun, []() {
+		return []() {
+			fmt::memory_buffer message;
+			for (size_t i = 0; i < linesPerRun; i++) {
+				message.clear();
+				fmt::format_to(message, "BENCH tick {} took {:.2f} ms for {}", i, 1.25, "entities");
+				Micro::doNotOptimize(message.data());
+			}
+		};
+	});
+
+	// What the calling thread pays once the async backend is running. It
+	// writes to a binary log in the temp directory, so the console stays clean,
+	// and the ring is flushed between runs so no line is dropped.
+	Micro::add("log", "async", linesPerRun, []() {
+		std::filesystem::path path = std::filesystem::temp_directory_path() / "microbench.sslog";
+		Log::startAsync(path.string());
+		return []() {
+			for (size_t i = 0; i < linesPerRun; i++) {
+				Log::info("BENCH tick {} took {:.2f} ms for {}", i, 1.25, "entities");
+			}
+		};
+	}, &Log::flush);
+}
@@ -0,0 +1,85 @@
+#include "Harness.h"
+#include "Inputs.h"
+
+#include "Bench.h"
+#include "Game.h"
+#include "SpriteKernels.h"
+
+#include <algorithm>
+#include <memory>
+
+
+namespace {
+	// A generated level with every diamond turned a different way, so the
+	// sines and cosines aren't all of the same angle
+	struct Data {
+		explicit Data(size_t n)
+			: state(Game::generatedLevel(static_cast<uint32_t>(n), 1))
+			, transforms(2 * n)
+		{
+			std::vector<float> angles = Inputs::angles(n, 5);
+			std::copy(angles.begin(), angles.end(), state.diamondAngle());
+		}
+
+		GameState state;
+		std::vector<Affine2D> transforms;
+	};
+
+	// A whole simulation tick with the benchmark's scripted input
+	struct Simulation {
+		Simulation(size_t n, Game::Arithmetic arithmetic)
+			: game(Game::generatedLevel(static_cast<uint32_t>(n), 1), jobs, arithmetic)
+		{}
+
+		JobSystem jobs;
+		Game game;
+		uint64_t tick = 0;
+	};
+
+	// Every diamond's and fire's transform, i.e. two sprites per entity
+	void addForSize(size_t n) {
+		Micro::add("sprites", "object", 2 * n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d, n]() {
+				for (uint32_t i = 0; i < n; i++) {
+					d->transforms[i] = Game::diamondTransform(d->state, i);
+					d->transforms[n + i] = Game::fireTransform(d->state, i);
+				}
+				Micro::doNotOptimize(d->transforms.data());
+			};
+		});
+
+		for (SpriteKernels::Isa isa : { SpriteKernels::Isa::Scalar, SpriteKernels::Isa::SSE, SpriteKernels::Isa::AVX2 }) {
+			if (static_cast<int>(isa) > static_cast<int>(SpriteKernels::best())) {
+				continue;
+			}
+			Micro::add("sprites", SpriteKernels::name(isa), 2 * n, [n, isa]() {
+				SpriteKernels::use(isa);
+				auto d = std::make_shared<Data>(n);
+				return [d, n]() {
+					Game::spriteTransforms(d->state, d->transforms.data(), d->transforms.data() + n);
+					Micro::doNotOptimize(d->transforms.data());
+				};
+			});
+		}
+
+		for (Game::Arithmetic arithmetic : { Game::Arithmetic::Float, Game::Arithmetic::FixedPoint }) {
+			const char* variant = arithmetic == Game::Arithmetic::Float ? "float" : "fixed";
+			Micro::add("tick", variant, n, [n, arithmetic]() {
+				// The kernel benchmarks above leave whichever kernel ran last
+				SpriteKernels::use(SpriteKernels::best());
+				auto s = std::make_shared<Simulation>(n, arithmetic);
+				return [s]() {
+					s->game.tick(BenchInput(s->tick++));
+					Micro::doNotOptimize(s->game.getState().data());
+				};
+			});
+		}
+	}
+}
+
+
+void AddSpriteBenchmarks() {
+	addForSize(Inputs::small);
+	addForSize(Inputs::large);
+}
@@ -0,0 +1,289 @@
+#include "Harness.h"
+#include "Inputs.h"
+
+#include "AabbTree.h"
+#include "AlphaMask.h"
+#include "SpriteKernels.h"
+#include "Transforms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+
+namespace {
+	// The 4x4 forms the transforms were built with before Affine2D, kept as a
+	// reference point
+	glm::mat4 Translation4(float x, float y) {
+		glm::mat4 m(1.f);
+		m[3] = glm::vec4(x, y, 0.f, 1.f);
+		return m;
+	}
+
+	glm::mat4 Rotation4(float theta) {
+		return glm::mat4(
+			std::cos(theta), -std::sin(theta), 0.f, 0.f,
+			std::sin(theta), std::cos(theta), 0.f, 0.f,
+			0.f, 0.f, 1.f, 0.f,
+			0.f, 0.f, 0.f, 1.f
+		);
+	}
+
+	struct Data {
+		explicit Data(size_t n)
+			: positions(Inputs::points(n, 1))
+			, targets(Inputs::points(n, 2))
+			, thetas(Inputs::angles(n, 3))
+			, angles(Inputs::angles(n, 4))
+			, matrices(n)
+			, mat4s(n)
+			, flags(n)
+			, headings(n)
+			, hits((n + 63) / 64)
+		{
+			for (const glm::vec2& p : positions) {
+				xs.push_back(p.x);
+				ys.push_back(p.y);
+			}
+		}
+
+		std::vector<glm::vec2> positions;
+		std::vector<glm::vec2> targets;
+		std::vector<float> thetas;
+		std::vector<float> angles;
+		std::vector<Affine2D> matrices;
+		std::vector<glm::mat4> mat4s;
+		std::vector<char> flags;
+		std::vector<float> headings;
+		// The positions again as separate arrays, and one hit bit per point
+		std::vector<float> xs;
+		std::vector<float> ys;
+		std::vector<uint64_t> hits;
+	};
+
+	// A filled disc, standing in for a sprite's drawn texels
+	AlphaMask DiscMask(int size) {
+		std::vector<unsigned char> pixels(size_t(size) * size * 2, 255);
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				float dx = x + 0.5f - size / 2.f;
+				float dy = y + 0.5f - size / 2.f;
+				pixels[(size_t(y) * size + x) * 2 + 1] = dx * dx + dy * dy < size * size / 4.f ? 255 : 0;
+			}
+		}
+		return AlphaMask::fromPixels(pixels.data(), size, size, 2);
+	}
+
+	// Sprites of half-size 0.1, each paired with one a short way off, so most
+	// pairs get past the bounding boxes as hit test candidates do
+	AlphaMask::Pose PairPose(const Data& d, size_t i, bool partner) {
+		glm::vec2 centre = d.positions[i] + (partner ? 0.15f * d.targets[i] : glm::vec2(0.f));
+		float theta = partner ? d.angles[i] : d.thetas[i];
+		glm::vec2 axisX = 0.1f * glm::vec2(std::cos(theta), std::sin(theta));
+		return AlphaMask::Pose{
+			Fixed::fromFloat(centre.x), Fixed::fromFloat(centre.y),
+			Fixed::fromFloat(axisX.x), Fixed::fromFloat(axisX.y),
+			Fixed::fromFloat(-axisX.y), Fixed::fromFloat(axisX.x),
+		};
+	}
+
+	void addForSize(size_t n) {
+		// Rotation about a point, then a step along the heading, as the old
+		// per-object transform stacks did
+		Micro::add("compose", "scalar", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				for (size_t i = 0; i < d->matrices.size(); i++) {
+					glm::vec2 pos = d->positions[i];
+					float theta = d->thetas[i];
+					d->matrices[i] = MakeTranslationMatrix(0.01f, theta) * Reset(pos, 1) * MakeRotationMatrix(theta) * Reset(pos, -1);
+				}
+				Micro::doNotOptimize(d->matrices.data());
+			};
+		});
+
+		Micro::add("compose", "mat4", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				for (size_t i = 0; i < d->mat4s.size(); i++) {
+					glm::vec2 pos = d->positions[i];
+					float theta = d->thetas[i];
+					d->mat4s[i] = Translation4(std::cos(theta) * 0.01f, std::sin(theta) * 0.01f)
+						* Translation4(pos.x, pos.y) * Rotation4(theta) * Translation4(-pos.x, -pos.y);
+				}
+				Micro::doNotOptimize(d->mat4s.data());
+			};
+		});
+
+		// Just the multiply: parent times local, the step every child sprite
+		// takes, with the trigonometry already done
+		Micro::add("product", "affine", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			std::vector<Affine2D> locals(n);
+			for (size_t i = 0; i < n; i++) {
+				d->matrices[i] = Affine2D::trs(d->positions[i], d->thetas[i], glm::vec2(0.1f));
+				locals[i] = Affine2D::trs(d->targets[i], d->angles[i], glm::vec2(0.3f, 0.4f));
+			}
+			return [d, locals]() {
+				for (size_t i = 0; i < d->matrices.size(); i++) {
+					d->matrices[i] = d->matrices[i] * locals[i];
+				}
+				Micro::doNotOptimize(d->matrices.data());
+			};
+		});
+
+		Micro::add("product", "mat4", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			std::vector<glm::mat4> locals(n);
+			for (size_t i = 0; i < n; i++) {
+				d->mat4s[i] = Affine2D::trs(d->positions[i], d->thetas[i], glm::vec2(0.1f)).toMat4();
+				locals[i] = Affine2D::trs(d->targets[i], d->angles[i], glm::vec2(0.3f, 0.4f)).toMat4();
+			}
+			return [d, locals]() {
+				for (size_t i = 0; i < d->mat4s.size(); i++) {
+					d->mat4s[i] = d->mat4s[i] * locals[i];
+				}
+				Micro::doNotOptimize(d->mat4s.data());
+			};
+		});
+
+		Micro::add("children", "scalar", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				for (size_t i = 0; i < d->matrices.size(); i++) {
+					d->matrices[i] = MakeChildrenMatrix(d->positions[i], d->thetas[i], d->targets[i], static_cast<int>(i & 15) + 1);
+				}
+				Micro::doNotOptimize(d->matrices.data());
+			};
+		});
+
+		// Every point against one ship, as the per-tick hit tests do
+		Micro::add("close", "scalar", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				glm::vec2 ship = d->targets[0];
+				for (size_t i = 0; i < d->flags.size(); i++) {
+					d->flags[i] = Close(ship, d->positions[i]);
+				}
+				Micro::doNotOptimize(d->flags.data());
+			};
+		});
+
+		// The squared-distance, branch-free form Game's hit test uses
+		Micro::add("close", "branchless", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				glm::vec2 ship = d->targets[0];
+				const float range = 0.1f;
+				for (size_t i = 0; i < d->flags.size(); i++) {
+					float dx = d->positions[i].x - ship.x;
+					float dy = d->positions[i].y - ship.y;
+					d->flags[i] = dx * dx + dy * dy < range * range;
+				}
+				Micro::doNotOptimize(d->flags.data());
+			};
+		});
+
+		// The batched kernel, which tests every point
+		Micro::add("close", "kernel", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				SpriteKernels::hitTest(d->targets[0], 0.1f, d->xs.data(), d->ys.data(), nullptr, nullptr, d->xs.size(), d->hits.data());
+				Micro::doNotOptimize(d->hits.data());
+			};
+		});
+
+		// The broadphase tree Game queries, which only visits the boxes near
+		// the ship, followed by the exact test on those
+		Micro::add("close", "aabbtree", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			auto tree = std::make_shared<AabbTree>(n);
+			for (size_t i = 0; i < n; i++) {
+				tree->insert(Aabb::around(d->positions[i], 0.1f), static_cast<uint32_t>(i));
+			}
+			return [d, tree]() {
+				glm::vec2 ship = d->targets[0];
+				std::fill(d->hits.begin(), d->hits.end(), 0);
+				tree->query(Aabb::around(ship, 0.f), [&](uint32_t i) {
+					float dx = d->xs[i] - ship.x;
+					float dy = d->ys[i] - ship.y;
+					d->hits[i / 64] |= uint64_t(dx * dx + dy * dy < 0.1f * 0.1f) << (i % 64);
+				});
+				Micro::doNotOptimize(d->hits.data());
+			};
+		});
+
+		// The narrow phase for a candidate pair: circles, or the texels of two
+		// sprite-sized masks
+		Micro::add("narrow", "circle", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				std::fill(d->hits.begin(), d->hits.end(), 0);
+				for (size_t i = 0; i < d->positions.size(); i++) {
+					glm::vec2 offset = 0.15f * d->targets[i];
+					d->hits[i / 64] |= uint64_t(glm::dot(offset, offset) < 0.2f * 0.2f) << (i % 64);
+				}
+				Micro::doNotOptimize(d->hits.data());
+			};
+		});
+
+		Micro::add("narrow", "alphamask", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			auto masks = std::make_shared<std::vector<AlphaMask>>();
+			masks->push_back(DiscMask(32));
+			masks->push_back(DiscMask(64));
+			auto poses = std::make_shared<std::vector<AlphaMask::Pose>>();
+			for (size_t i = 0; i < n; i++) {
+				poses->push_back(PairPose(*d, i, false));
+				poses->push_back(PairPose(*d, i, true));
+			}
+			return [d, masks, poses]() {
+				std::fill(d->hits.begin(), d->hits.end(), 0);
+				for (size_t i = 0; i < d->positions.size(); i++) {
+					bool hit = AlphaMask::overlaps((*masks)[0], (*poses)[2 * i], (*masks)[1], (*poses)[2 * i + 1]);
+					d->hits[i / 64] |= uint64_t(hit) << (i % 64);
+				}
+				Micro::doNotOptimize(d->hits.data());
+			};
+		});
+
+		// The bearing from each position to its target, as the ship steers
+		Micro::add("atan2", "std", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				for (size_t i = 0; i < d->headings.size(); i++) {
+					glm::vec2 to = d->targets[i] - d->positions[i];
+					d->headings[i] = std::atan2(to.y, to.x);
+				}
+				Micro::doNotOptimize(d->headings.data());
+			};
+		});
+
+		Micro::add("atan2", "fast", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				for (size_t i = 0; i < d->headings.size(); i++) {
+					glm::vec2 to = d->targets[i] - d->positions[i];
+					d->headings[i] = FastAtan2(to.y, to.x);
+				}
+				Micro::doNotOptimize(d->headings.data());
+			};
+		});
+
+		Micro::add("goleft", "scalar", n, [n]() {
+			auto d = std::make_shared<Data>(n);
+			return [d]() {
+				for (size_t i = 0; i < d->flags.size(); i++) {
+					d->flags[i] = Goleft(d->thetas[i], d->angles[i]);
+				}
+				Micro::doNotOptimize(d->flags.data());
+			};
+		});
+	}
+}
+
+
+void AddTransformBenchmarks() {
+	addForSize(Inputs::small);
+	addForSize(Inputs::large);
+}
@@ -0,0 +1,67 @@
+//------------------------------------------------------------------------------
+// Microbenchmarks for the game's hot primitives.
+//
+// Usage:
+//   microbench [--filter=<text>] [--json=<file>] [--samples=<n>] [--sample-ms=<ms>]
+//
+// --filter    only runs benchmarks whose "group/variant" name contains <text>
+// --json      writes the results to <file> instead of stdout
+// --samples   samples per benchmark (default 9); the median is reported
+// --sample-ms minimum length of one sample (default 20)
+//
+// Progress goes to stderr, the JSON results to stdout, so
+//   microbench > before.json
+// captures one build's numbers for comparing with the next.
+//------------------------------------------------------------------------------
+
+#include "Harness.h"
+
+#include "Log.h"
+
+#include <argh.h>
+
+#include <cstdio>
+#include <string>
+
+
+void AddTransformBenchmarks();
+void AddGeometryBenchmarks();
+void AddSpriteBenchmarks();
+void AddLogBenchmarks();
+
+
+int main(int argc, char* argv[]) {
+	argh::parser cmdl(argc, argv);
+	std::string filter;
+	std::string jsonPath;
+	int samples = 9;
+	double sampleMs = 20.0;
+	cmdl("filter") >> filter;
+	cmdl("json") >> jsonPath;
+	cmdl("samples", samples) >> samples;
+	cmdl("sample-ms", sampleMs) >> sampleMs;
+	if (samples < 1 || sampleMs <= 0.0) {
+		Log::error("--samples and --sample-ms must be positive");
+		return 1;
+	}
+
+	AddTransformBenchmarks();
+	AddGeometryBenchmarks();
+	AddSpriteBenchmarks();
+	AddLogBenchmarks(); // last: the async benchmark leaves the log writer running
+
+	std::vector<Micro::Result> results = Micro::runAll(filter, samples, sampleMs / 1000.0);
+	Log::stopAsync();
+
+	std::string json = Micro::toJson(results);
+	std::FILE* file = jsonPath.empty() ? stdout : std::fopen(jsonPath.c_str(), "w");
+	if (!file) {
+		Log::error("BENCH couldn't write {}", jsonPath);
+		return 1;
+	}
+	std::fwrite(json.data(), 1, json.size(), file);
+	if (file != stdout) {
+		std::fclose(file);
+	}
+	return 0;
+}
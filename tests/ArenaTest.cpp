@@ -0,0 +1,92 @@
+#include "Check.h"
+
+#include "FrameArena.h"
+
+#include <numeric>
+#include <vector>
+
+
+namespace {
+	// reset() must never hand memory back while something still uses it
+	void resetWaitsForReleases() {
+		FrameArena arena(1024);
+		void* a = arena.allocate(16);
+		void* b = arena.allocate(16);
+		CHECK(a != b);
+		CHECK(!arena.reset());
+
+		arena.release();
+		CHECK(!arena.reset());
+		arena.release();
+		CHECK(arena.reset());
+		CHECK(arena.getUsed() == 0);
+	}
+
+	// A frame that overflows the block is served from the heap, and the next
+	// reset() grows the block so the same frame fits in it
+	void growsAfterOverflow() {
+		const size_t capacity = 256;
+		const size_t allocations = 8;
+		const size_t size = 128;
+		FrameArena arena(capacity);
+
+		for (size_t i = 0; i < allocations; i++) {
+			CHECK(arena.allocate(size) != nullptr);
+		}
+		CHECK(arena.getCapacity() == capacity);
+		CHECK(arena.getUsed() > capacity);
+		for (size_t i = 0; i < allocations; i++) {
+			arena.release();
+		}
+		CHECK(arena.reset());
+		size_t grown = arena.getCapacity();
+		CHECK(grown >= allocations * size);
+
+		// Fits now: the used bytes stay within the block and the next reset
+		// has nothing to grow for
+		for (size_t i = 0; i < allocations; i++) {
+			arena.allocate(size);
+		}
+		CHECK(arena.getUsed() <= grown);
+		for (size_t i = 0; i < allocations; i++) {
+			arena.release();
+		}
+		CHECK(arena.reset());
+		CHECK(arena.getCapacity() == grown);
+	}
+
+	// Every reallocation of a growing vector releases the block before it, so
+	// the arena resets as soon as the vector is gone
+	void backsStandardContainers() {
+		FrameArena arena(1024);
+		{
+			std::vector<int, ArenaAllocator<int>> numbers{ ArenaAllocator<int>(&arena) };
+			for (int i = 0; i < 1000; i++) {
+				numbers.push_back(i);
+			}
+			CHECK(std::accumulate(numbers.begin(), numbers.end(), 0) == 999 * 1000 / 2);
+			CHECK(arena.getUsed() >= 1000 * sizeof(int));
+			CHECK(!arena.reset());
+
+			// Copies share the arena
+			std::vector<int, ArenaAllocator<int>> copy = numbers;
+			CHECK(copy.get_allocator() == numbers.get_allocator());
+			CHECK(copy == numbers);
+		}
+		CHECK(arena.reset());
+
+		// Without an arena it's the heap
+		std::vector<int, ArenaAllocator<int>> heap;
+		heap.assign(100, 7);
+		CHECK(heap.get_allocator().getArena() == nullptr);
+		CHECK(std::accumulate(heap.begin(), heap.end(), 0) == 700);
+	}
+}
+
+
+int main() {
+	resetWaitsForReleases();
+	growsAfterOverflow();
+	backsStandardContainers();
+	return Check::result();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Just enough of a test harness for CTest: CHECK() reports a condition that
+// doesn't hold, with where it is, and carries on; main() returns
+// Check::result(), which is nonzero after any failure.
+//
+// Example:
+//   int main() {
+//       CHECK(arena.reset());
+//       return Check::result();
+//   }
+//------------------------------------------------------------------------------
+
+#include <fmt/format.h>
+
+
+namespace Check {
+	inline int failures = 0;
+
+	inline void fail(const char* condition, const char* file, int line) {
+		fmt::print(stderr, "{}:{}: CHECK({}) failed\n", file, line, condition);
+		failures++;
+	}
+
+	inline int result() {
+		return failures == 0 ? 0 : 1;
+	}
+}
+
+#define CHECK(condition) ((condition) ? (void)0 : Check::fail(#condition, __FILE__, __LINE__))
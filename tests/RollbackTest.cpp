@@ -0,0 +1,106 @@
+#include "Check.h"
+
+#include "Bench.h"
+#include "Game.h"
+#include "JobSystem.h"
+#include "Rollback.h"
+
+#include <cstdint>
+
+
+namespace {
+	const uint32_t entities = 64;
+	const uint64_t seed = 1;
+	const uint64_t ticks = 300;
+	const size_t history = 128;
+
+	// The hash a game ends on after `ticks` ticks of the benchmark's input
+	uint64_t freshRun(JobSystem& jobs, Game::Arithmetic arithmetic) {
+		Game game(Game::generatedLevel(entities, seed), jobs, arithmetic);
+		for (uint64_t t = 0; t < ticks; t++) {
+			game.tick(BenchInput(t));
+		}
+		return game.getState().hash();
+	}
+
+	// The ticks run standing still, as if a remote player's input hadn't
+	// arrived yet
+	bool guessed(uint64_t t) {
+		return t >= 200 && t < 220;
+	}
+
+	void resimulatesCorrections(JobSystem& jobs, Game::Arithmetic arithmetic) {
+		uint64_t expected = freshRun(jobs, arithmetic);
+
+		Game game(Game::generatedLevel(entities, seed), jobs, arithmetic);
+		Rollback rollback(game, history);
+		for (uint64_t t = 0; t < ticks; t++) {
+			rollback.tick(guessed(t) ? TickInput() : BenchInput(t));
+		}
+		CHECK(game.getState().hash() != expected);
+
+		for (uint64_t t = 0; t < ticks; t++) {
+			if (guessed(t)) {
+				CHECK(rollback.correct(t, BenchInput(t)));
+			}
+		}
+		CHECK(rollback.resimulate() == ticks - 200);
+		CHECK(rollback.getTick() == ticks);
+		CHECK(game.getState().hash() == expected);
+
+		// Out of the window, or not happened yet
+		CHECK(!rollback.correct(rollback.getOldestTick() - 1, TickInput()));
+		CHECK(!rollback.correct(ticks, TickInput()));
+		CHECK(rollback.resimulate() == 0);
+	}
+
+	void rewindsAndReplays(JobSystem& jobs, Game::Arithmetic arithmetic) {
+		uint64_t expected = freshRun(jobs, arithmetic);
+
+		Game game(Game::generatedLevel(entities, seed), jobs, arithmetic);
+		Rollback rollback(game, history);
+		for (uint64_t t = 0; t < ticks; t++) {
+			rollback.tick(BenchInput(t));
+		}
+		CHECK(game.getState().hash() == expected);
+
+		CHECK(rollback.rewind(ticks - 50));
+		CHECK(rollback.getTick() == ticks - 50);
+		for (uint64_t t = ticks - 50; t < ticks; t++) {
+			rollback.tick(BenchInput(t));
+		}
+		CHECK(game.getState().hash() == expected);
+
+		CHECK(!rollback.rewind(rollback.getOldestTick() - 1));
+		CHECK(!rollback.rewind(ticks + 1));
+	}
+
+	// Only the last `history` ticks can be rewound to, and rewinding before a
+	// correction forgets it along with the ticks after
+	void keepsItsWindow(JobSystem& jobs) {
+		Game game(Game::generatedLevel(entities, seed), jobs);
+		CHECK(Rollback(game, 0).getCapacity() == 1);
+
+		Rollback rollback(game, history);
+		for (uint64_t t = 0; t < ticks; t++) {
+			rollback.tick(BenchInput(t));
+		}
+		CHECK(rollback.getOldestTick() == ticks - history);
+
+		CHECK(rollback.correct(ticks - 10, TickInput()));
+		CHECK(rollback.rewind(ticks - 20));
+		CHECK(rollback.resimulate() == 0);
+		CHECK(rollback.getTick() == ticks - 20);
+	}
+}
+
+
+int main() {
+	JobSystem jobs;
+	for (Game::Arithmetic arithmetic : { Game::Arithmetic::Float, Game::Arithmetic::FixedPoint }) {
+		resimulatesCorrections(jobs, arithmetic);
+		rewindsAndReplays(jobs, arithmetic);
+	}
+	keepsItsWindow(jobs);
+	return Check::result();
+}
@@ -0,0 +1,272 @@
+//------------------------------------------------------------------------------
+// Turns a binary log file (453-skeleton --log-file=<file>) back into text.
+//
+// Usage:
+//   logdecode <file>           one line per message, like the console output
+//   logdecode <file> --json    one JSON object per message, for scripts
+//
+// See 453-skeleton/BinaryLogFormat.h for the file layout.
+//------------------------------------------------------------------------------
+
+#include "BinaryLogFormat.h"
+
+#include <argh.h>
+#include <fmt/format.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+
+namespace {
+	using BinaryLog::Arg;
+	using BinaryLog::Entry;
+
+	using Value = std::variant<bool, char, int64_t, uint64_t, float, double, std::string>;
+
+	struct Message {
+		double time = 0.0;		// seconds since the log was opened
+		uint8_t level = 0;
+		std::string format;
+		std::vector<Value> args;
+		std::string text;
+	};
+
+	class Reader {
+	public:
+		explicit Reader(std::vector<char> bytes) : bytes(std::move(bytes)) {}
+
+		bool atEnd() const { return position >= bytes.size(); }
+		bool failed() const { return error; }
+
+		uint8_t byte() {
+			if (atEnd()) {
+				error = true;
+				return 0;
+			}
+			return static_cast<uint8_t>(bytes[position++]);
+		}
+
+		uint64_t varint() {
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				uint8_t b = byte();
+				value |= static_cast<uint64_t>(b & 0x7f) << shift;
+				if (!(b & 0x80)) break;
+			}
+			return value;
+		}
+
+		template <typename T>
+		T raw() {
+			T value{};
+			if (position + sizeof(T) > bytes.size()) {
+				error = true;
+				position = bytes.size();
+				return value;
+			}
+			std::memcpy(&value, bytes.data() + position, sizeof(T));
+			position += sizeof(T);
+			return value;
+		}
+
+		std::string string() {
+			uint64_t length = varint();
+			if (position + length > bytes.size()) {
+				error = true;
+				position = bytes.size();
+				return std::string();
+			}
+			std::string text(bytes.data() + position, length);
+			position += length;
+			return text;
+		}
+
+	private:
+		std::vector<char> bytes;
+		size_t position = 0;
+		bool error = false;
+	};
+
+
+	std::string format(const Message& message) {
+		if (message.format.empty()) {
+			return message.text;
+		}
+		fmt::dynamic_format_arg_store<fmt::format_context> store;
+		for (const Value& value : message.args) {
+			std::visit([&](const auto& v) { store.push_back(v); }, value);
+		}
+		try {
+			return fmt::vformat(message.format, store);
+		}
+		catch (const fmt::format_error& e) {
+			return fmt::format("{} (bad format: {})", message.format, e.what());
+		}
+	}
+
+	std::string jsonEscape(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			switch (c) {
+				case '"':  escaped += "\\\""; break;
+				case '\\': escaped += "\\\\"; break;
+				case '\n': escaped += "\\n"; break;
+				case '\r': escaped += "\\r"; break;
+				case '\t': escaped += "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20) {
+						escaped += fmt::format("\\u{:04x}", c);
+					}
+					else {
+						escaped += c;
+					}
+			}
+		}
+		return escaped;
+	}
+
+	std::string json(const Value& value) {
+		return std::visit([](const auto& v) -> std::string {
+			using T = std::decay_t<decltype(v)>;
+			if constexpr (std::is_same_v<T, std::string>) {
+				return "\"" + jsonEscape(v) + "\"";
+			}
+			else if constexpr (std::is_same_v<T, char>) {
+				return "\"" + jsonEscape(std::string(1, v)) + "\"";
+			}
+			else if constexpr (std::is_same_v<T, bool>) {
+				return v ? "true" : "false";
+			}
+			else if constexpr (std::is_floating_point_v<T>) {
+				// JSON has no NaN or infinity
+				return std::isfinite(v) ? fmt::format("{}", v) : "null";
+			}
+			else {
+				return fmt::format("{}", v);
+			}
+		}, value);
+	}
+
+	const char* levelName(uint8_t level) {
+		return level < BinaryLog::levelCount ? BinaryLog::levelNames[level] : "?";
+	}
+
+	void print(const Message& message, bool asJson) {
+		if (!asJson) {
+			fmt::print("{:12.6f} [{}]: {}\n", message.time, levelName(message.level), format(message));
+			return;
+		}
+		std::string args;
+		for (const Value& value : message.args) {
+			args += (args.empty() ? "" : ",") + json(value);
+		}
+		fmt::print("{{\"time\":{:.9f},\"level\":\"{}\",\"format\":\"{}\",\"args\":[{}],\"message\":\"{}\"}}\n",
+			message.time, levelName(message.level), jsonEscape(message.format), args, jsonEscape(format(message)));
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	argh::parser cmdl(argc, argv);
+	std::string path = cmdl[1];
+	bool asJson = cmdl["json"];
+	if (path.empty()) {
+		fmt::print(stderr, "usage: logdecode <file> [--json]\n");
+		return 1;
+	}
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		fmt::print(stderr, "logdecode: can't open {}\n", path);
+		return 1;
+	}
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	Reader in(std::move(bytes));
+
+	char magic[4];
+	for (char& c : magic) c = static_cast<char>(in.byte());
+	uint32_t version = in.raw<uint32_t>();
+	in.raw<uint64_t>(); // wall clock at startup
+	uint64_t start = in.raw<uint64_t>();
+	if (in.failed() || std::memcmp(magic, BinaryLog::magic, sizeof(magic)) != 0) {
+		fmt::print(stderr, "logdecode: {} is not a binary log\n", path);
+		return 1;
+	}
+	if (version != BinaryLog::version) {
+		fmt::print(stderr, "logdecode: {} has version {}, expected {}\n", path, version, BinaryLog::version);
+		return 1;
+	}
+
+	std::unordered_map<uint64_t, std::string> formats;
+	std::unordered_map<uint64_t, std::string> strings;
+	uint64_t time = start;
+	uint64_t messages = 0;
+
+	while (!in.atEnd() && !in.failed()) {
+		Entry entry = static_cast<Entry>(in.byte());
+		if (entry == Entry::End) break;
+
+		if (entry == Entry::Format || entry == Entry::String) {
+			uint64_t id = in.varint();
+			std::string text = in.string();
+			(entry == Entry::Format ? formats : strings)[id] = std::move(text);
+		}
+		else if (entry == Entry::Message || entry == Entry::Text) {
+			Message message;
+			message.level = in.byte();
+			time += static_cast<uint64_t>(BinaryLog::unzigzag(in.varint()));
+			message.time = static_cast<int64_t>(time - start) * 1e-9;
+			if (entry == Entry::Text) {
+				message.text = in.string();
+			}
+			else {
+				message.format = formats[in.varint()];
+				uint8_t count = in.byte();
+				for (uint8_t i = 0; i < count && !in.failed(); i++) {
+					switch (static_cast<Arg>(in.byte())) {
+						case Arg::Bool:         message.args.emplace_back(in.byte() != 0); break;
+						case Arg::Char:         message.args.emplace_back(static_cast<char>(in.byte())); break;
+						case Arg::Signed:       message.args.emplace_back(BinaryLog::unzigzag(in.varint())); break;
+						case Arg::Unsigned:     message.args.emplace_back(in.varint()); break;
+						case Arg::Float:        message.args.emplace_back(in.raw<float>()); break;
+						case Arg::Double:       message.args.emplace_back(in.raw<double>()); break;
+						case Arg::String:       message.args.emplace_back(strings[in.varint()]); break;
+						case Arg::InlineString: message.args.emplace_back(in.string()); break;
+						default:
+							fmt::print(stderr, "logdecode: unknown argument type, stopping\n");
+							return 1;
+					}
+				}
+			}
+			if (!in.failed()) {
+				print(message, asJson);
+				messages++;
+			}
+		}
+		else if (entry == Entry::Dropped) {
+			uint64_t dropped = in.varint();
+			if (!asJson) {
+				fmt::print("{:>12} [WARN]: {} lines were dropped here (log buffer full)\n", "", dropped);
+			}
+			else {
+				fmt::print("{{\"dropped\":{}}}\n", dropped);
+			}
+		}
+		else {
+			fmt::print(stderr, "logdecode: unknown entry type {}, stopping\n", static_cast<int>(entry));
+			return 1;
+		}
+	}
+
+	if (in.failed()) {
+		fmt::print(stderr, "logdecode: {} is truncated after {} messages\n", path, messages);
+	}
+	return 0;
+}